@@ -0,0 +1,86 @@
+/****************************************************************************
+   Program:     $Id: $
+   Date:        $Date: $
+   Description: yarrp per origin AS probe accounting.  Caps the probing
+                rate and total probes of each AS in the BGP table.
+****************************************************************************/
+#include "yarrp.h"
+
+AsnBudget::AsnBudget(Patricia *tree, uint32_t _rate, uint64_t _max) :
+    rate(_rate), max(_max), ids(tree->prefixes()) {
+    map<int, uint32_t> dense;
+    map<int, uint32_t>::iterator it;
+
+    for (uint32_t slot = 1; slot < ids.size(); slot++) {
+        int asn = tree->value(slot);
+        it = dense.find(asn);
+        if (it == dense.end()) {
+            it = dense.insert(make_pair(asn, (uint32_t) asns.size())).first;
+            asns.push_back(asn);
+        }
+        ids[slot] = it->second;
+    }
+    state.resize(asns.size() ? asns.size() : 1);
+    memset(&state[0], 0, state.size() * sizeof(asn_state_t));
+    debug(LOW, ">> Per-AS caps over " << asns.size() << " origin ASes");
+}
+
+bool
+AsnBudget::charge(uint32_t slot, uint32_t second) {
+    asn_state_t *s = &state[ids[slot]];
+    uint64_t w, nw;
+
+    if (max and __atomic_load_n(&s->sent, __ATOMIC_RELAXED) >= max) {
+        __atomic_store_n(&s->capped, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    if (rate) {
+        w = __atomic_load_n(&s->window, __ATOMIC_RELAXED);
+        do {
+            if ((w >> 32) != second)
+                nw = ((uint64_t) second << 32) | 1;
+            else if ((uint32_t) w < rate)
+                nw = w + 1;
+            else {
+                __atomic_store_n(&s->capped, 1, __ATOMIC_RELAXED);
+                return false;
+            }
+        } while (not __atomic_compare_exchange_n(&s->window, &w, nw, true,
+                                                 __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    }
+    __atomic_add_fetch(&s->sent, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+/* Orders AS ids by probes charged, most first */
+struct by_sent {
+    const std::vector<asn_state_t> *state;
+    by_sent(const std::vector<asn_state_t> *_state) : state(_state) {}
+    bool operator()(uint32_t a, uint32_t b) const {
+        return (*state)[a].sent > (*state)[b].sent;
+    }
+};
+
+/* Trailer lines: ASes probed and capped, and the busiest ones */
+void
+AsnBudget::dump(FILE *out) {
+    vector<uint32_t> order;
+    uint32_t probed = 0, capped = 0;
+    size_t top;
+
+    for (uint32_t id = 0; id < asns.size(); id++) {
+        if (state[id].sent)
+            probed++;
+        if (state[id].capped)
+            capped++;
+        order.push_back(id);
+    }
+    top = min((size_t) ASNBUDGET_TOP, order.size());
+    partial_sort(order.begin(), order.begin() + top, order.end(), by_sent(&state));
+    fprintf(out, "# ASNs_Probed: %" PRIu32 "\n", probed);
+    fprintf(out, "# ASNs_Capped: %" PRIu32 "\n", capped);
+    fprintf(out, "# Top_ASNs:");
+    for (size_t i = 0; i < top and state[order[i]].sent; i++)
+        fprintf(out, " %d:%" PRIu64, asns[order[i]], state[order[i]].sent);
+    fprintf(out, "\n");
+}
@@ -0,0 +1,41 @@
+#ifndef _ASNBUDGET_H_
+#define _ASNBUDGET_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+/* Busiest origin ASes listed in the trailer */
+#define ASNBUDGET_TOP 10
+
+/* Probing of one origin AS */
+typedef struct {
+    uint64_t sent;    /* probes charged to the AS */
+    uint64_t window;  /* second << 32 | probes charged in that second */
+    uint8_t capped;   /* a probe was refused for a cap */
+} asn_state_t;
+
+/*
+ * Per origin AS probe accounting and caps: at most rate probes in any one
+ * second, and max probes overall (0 for no cap).  Each slot of the compiled
+ * lookup table maps to a dense id of its prefix's origin AS, so charging a
+ * probe is two array reads and an atomic update, shared by all senders.
+ * Probes over a cap are refused (the sender skips them), so a few huge
+ * ASes cannot dominate an entire-mode scan.
+ */
+class AsnBudget {
+    public:
+    AsnBudget(Patricia *tree, uint32_t rate, uint64_t max);
+    /* Whether a probe to the prefix in slot may be sent, and if so, count it */
+    bool charge(uint32_t slot, uint32_t second);
+    void dump(FILE *out);
+
+    private:
+    uint32_t rate;
+    uint64_t max;
+    std::vector<uint32_t> ids;      /* dense id of each slot's origin AS */
+    std::vector<int> asns;          /* ASN of each id */
+    std::vector<asn_state_t> state; /* indexed by id */
+};
+
+#endif
@@ -0,0 +1,42 @@
+/****************************************************************************
+   Program:     $Id: $
+   Date:        $Date: $
+   Description: yarrp benchmark mode.  Null-sink packet ring and per-stage
+                timing of the probe path.
+****************************************************************************/
+#include "yarrp.h"
+
+Bench::Bench() : packets(0), bytes(0) {
+    memset(&gen, 0, sizeof(gen));
+    memset(&filt, 0, sizeof(filt));
+    memset(&check, 0, sizeof(check));
+    memset(&build, 0, sizeof(build));
+    queued.n = 0;
+    ring = (uint8_t *) calloc(BENCH_RING, PKTSIZE);
+}
+
+Bench::~Bench() {
+    free(ring);
+}
+
+static void
+dump(FILE *out, const char *name, stage_t *s, uint64_t probes) {
+    fprintf(out, "# Bench_%s: %" PRIu64 " pairs, %.1f ns/pair, %.1f ns/probe\n",
+            name, s->pairs, s->pairs ? s->time * 1e9 / s->pairs : 0,
+            probes ? s->time * 1e9 / probes : 0);
+}
+
+/* Per stage cost, per pair it handled and per probe built, and in total */
+void
+Bench::dump(FILE *out) {
+    double total = gen.time + filt.time + check.time + build.time;
+
+    ::dump(out, "Generate", &gen, packets);
+    ::dump(out, "Filter", &filt, packets);
+    ::dump(out, "Check", &check, packets);
+    fprintf(out, "# Bench_Build: %" PRIu64 " probes, %.1f ns/probe\n",
+            build.pairs, build.pairs ? build.time * 1e9 / build.pairs : 0);
+    fprintf(out, "# Bench_Total: %" PRIu64 " probes, %.1f ns/probe, %.0f probes/s, %.1f bytes/probe\n",
+            packets, packets ? total * 1e9 / packets : 0, total > 0 ? packets / total : 0,
+            packets ? (double) bytes / packets : 0);
+}
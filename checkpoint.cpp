@@ -0,0 +1,88 @@
+/****************************************************************************
+   Program:     $Id: $
+   Date:        $Date: $
+   Description: scan state checkpoint and resume
+****************************************************************************/
+#include "yarrp.h"
+
+/* Read state of a previous run; adopts its seed so the same permutation
+   is generated */
+void Checkpoint::load() {
+    std::ifstream in(config->checkpoint);
+    std::string line;
+    size_t sep;
+
+    if (not in.good())
+        fatal("Cannot resume: unable to read %s", config->checkpoint);
+    while (getline(in, line)) {
+        if (line.empty() or line[0] == '#')
+            continue;
+        sep = line.find(": ");
+        if (sep == std::string::npos)
+            continue;
+        state[line.substr(0, sep)] = line.substr(sep + 2);
+    }
+    if (state.count("Position") == 0 or state.count("Seed") == 0)
+        fatal("Cannot resume: %s is not a yarrp checkpoint", config->checkpoint);
+    if (state["Targets"] != config->params["Targets"].first)
+        fatal("Cannot resume: checkpoint targets %s differ", state["Targets"].c_str());
+    if (state["Shard"] != config->params["Shard"].first)
+        fatal("Cannot resume: checkpoint shard %s differs", state["Shard"].c_str());
+    if (get("Max_TTL") != config->maxttl)
+        fatal("Cannot resume: checkpoint max_ttl %" PRIu64 " differs", get("Max_TTL"));
+    position = get("Position");
+    size = get("Size");
+    config->seed = get("Seed");
+    config->set("Seed", to_string(config->seed), true);
+    config->set("Resume_Position", to_string(position), true);
+    debug(LOW, ">> Resuming from " << config->checkpoint << " at position " << position);
+}
+
+/* Restore counters so progress and totals carry across the restart */
+void Checkpoint::restore(Stats *stats) {
+    stats->count = get("Pkts");
+    stats->nbr_skipped = get("Skipped_Nbr");
+    stats->bgp_outside = get("Outside_BGP");
+    stats->reload_blocked = get("Skipped_Reload");
+    stats->bgp_skipped = get("Skipped_BGP");
+    stats->reached_skipped = get("Skipped_Reached");
+    stats->stop_skipped = get("Skipped_Stop");
+}
+
+/* Ensure the target list built for this run matches the checkpointed one */
+void Checkpoint::verify(uint64_t count) {
+    if (size != count)
+        fatal("Cannot resume: %" PRIu64 " targets, checkpoint has %" PRIu64, count, size);
+}
+
+void Checkpoint::save(uint64_t pos, uint64_t count, Stats *stats) {
+    std::string tmp = std::string(config->checkpoint) + ".tmp";
+    FILE *fd = fopen(tmp.c_str(), "w");
+
+    if (fd == NULL) {
+        warn("Cannot write checkpoint %s: %s", tmp.c_str(), strerror(errno));
+        return;
+    }
+    fprintf(fd, "# yarrp checkpoint\n");
+    fprintf(fd, "Seed: %" PRIu32 "\n", config->seed);
+    fprintf(fd, "Targets: %s\n", config->params["Targets"].first.c_str());
+    fprintf(fd, "Max_TTL: %d\n", config->maxttl);
+    if (config->shard_n > 1)
+        fprintf(fd, "Shard: %s\n", config->params["Shard"].first.c_str());
+    fprintf(fd, "Size: %" PRIu64 "\n", count);
+    fprintf(fd, "Position: %" PRIu64 "\n", pos);
+    fprintf(fd, "Pkts: %" PRIu64 "\n", stats->count);
+    fprintf(fd, "Skipped_Nbr: %" PRIu64 "\n", stats->nbr_skipped);
+    fprintf(fd, "Outside_BGP: %" PRIu64 "\n", stats->bgp_outside);
+    fprintf(fd, "Skipped_Reload: %" PRIu64 "\n", stats->reload_blocked);
+    fprintf(fd, "Skipped_BGP: %" PRIu64 "\n", stats->bgp_skipped);
+    fprintf(fd, "Skipped_Reached: %" PRIu64 "\n", stats->reached_skipped);
+    fprintf(fd, "Skipped_Stop: %" PRIu64 "\n", stats->stop_skipped);
+    if (fclose(fd) != 0 or rename(tmp.c_str(), config->checkpoint) != 0)
+        warn("Cannot write checkpoint %s: %s", config->checkpoint, strerror(errno));
+    last = now();
+}
+
+uint64_t Checkpoint::get(const char *key) {
+    return strtoull(state[key].c_str(), NULL, 10);
+}
@@ -0,0 +1,47 @@
+/****************************************************************************
+   Program:     $Id: $
+   Date:        $Date: $
+   Description: scan state checkpoint and resume
+****************************************************************************/
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include <string>
+#include <map>
+
+/* Seconds between periodic checkpoints */
+#define CHECKPOINT_INTERVAL 10
+/* Probes between checks of the checkpoint clock (power of 2, minus 1) */
+#define CHECKPOINT_MASK 0x3ff
+
+/*
+ * Records the permutation position, seed and counters of a running scan to
+ * a small text file.  The file is rewritten atomically, so a scan that dies
+ * can be resumed from its last checkpoint; probes sent after that checkpoint
+ * are sent again, nothing is skipped.
+ */
+class Checkpoint {
+  public:
+  Checkpoint(YarrpConfig *_config) : config(_config), position(0), size(0), last(0) {};
+  void load();
+  void restore(Stats *stats);
+  void verify(uint64_t count);
+  void save(uint64_t pos, uint64_t count, Stats *stats);
+  inline void periodic(uint64_t pos, uint64_t count, Stats *stats) {
+    if (now() - last >= CHECKPOINT_INTERVAL)
+      save(pos, count, stats);
+  }
+
+  YarrpConfig *config;
+  uint64_t position;
+
+  private:
+  uint64_t get(const char *key);
+  std::map<std::string, std::string> state;
+  uint64_t size;
+  double last;
+};
+
+#endif /* CHECKPOINT_H */
@@ -0,0 +1,112 @@
+/****************************************************************************
+   Program:     $Id: $
+   Date:        $Date: $
+   Description: flattened DIR-24-8 IPv4 longest-prefix match table
+****************************************************************************/
+#include "yarrp.h"
+#include "snapshot.h"
+
+#define TBL24_SIZE (1 << 24)
+
+Dir24::Dir24() : tbl24(NULL), tbl8(NULL), values(NULL), ntbl8(0), nvalues(0), mapped(false) {
+}
+
+Dir24::~Dir24() {
+    if (not mapped)
+        free(tbl24);
+}
+
+static bool shorter(const route_t &a, const route_t &b) {
+    return a.bitlen < b.bitlen;
+}
+
+void
+Dir24::build(Patricia *tree) {
+    std::vector<route_t> routes;
+    uint32_t first, span, e, group;
+
+    /* calloc, so untouched (unrouted) parts of the table stay unmapped */
+    tbl24 = (uint32_t *) calloc(TBL24_SIZE, sizeof(uint32_t));
+    if (tbl24 == NULL)
+        fatal("%s: cannot allocate DIR-24-8 table", __func__);
+    valuesv.push_back(0);  /* code 0: no route */
+
+    tree->routes(routes);
+    valuesv.reserve(routes.size() + 1);
+    /* paint shorter prefixes first, so more specific ones overwrite them */
+    std::stable_sort(routes.begin(), routes.end(), shorter);
+    for (size_t i = 0; i < routes.size(); i++) {
+        route_t &r = routes[i];
+        uint32_t c = valuesv.size();
+        valuesv.push_back(r.value);
+        if (r.bitlen <= 24) {
+            span = 1 << (24 - r.bitlen);
+            first = (r.addr >> 8) & ~(span - 1);
+            for (uint32_t u = first; u < first + span; u++)
+                tbl24[u] = c;
+            continue;
+        }
+        /* longer than /24: expand the /24 into a tbl8 group */
+        e = tbl24[r.addr >> 8];
+        if (e & DIR24_EXT) {
+            group = e & ~DIR24_EXT;
+        } else {
+            group = tbl8v.size() >> 8;
+            tbl8v.resize(tbl8v.size() + 256, e);
+            tbl24[r.addr >> 8] = group | DIR24_EXT;
+        }
+        span = 1 << (32 - r.bitlen);
+        first = r.addr & 0xff & ~(span - 1);
+        for (uint32_t h = first; h < first + span; h++)
+            tbl8v[(group << 8) | h] = c;
+    }
+    tbl8 = tbl8v.data();
+    ntbl8 = tbl8v.size();
+    values = valuesv.data();
+    nvalues = valuesv.size();
+    debug(LOW, ">> Compiled " << routes.size() << " IPv4 prefixes into DIR-24-8 table ("
+          << groups() << " /24 groups)");
+}
+
+void
+Dir24::get(const uint32_t *addrs, size_t n, int **out) {
+    uint32_t a[DIR24_BATCH], e[DIR24_BATCH];
+
+    for (size_t base = 0; base < n; base += DIR24_BATCH) {
+        size_t m = std::min(n - base, (size_t) DIR24_BATCH);
+        for (size_t i = 0; i < m; i++) {
+            a[i] = ntohl(addrs[base + i]);
+            __builtin_prefetch(&tbl24[a[i] >> 8]);
+        }
+        for (size_t i = 0; i < m; i++) {
+            e[i] = tbl24[a[i] >> 8];
+            if (e[i] & DIR24_EXT)
+                __builtin_prefetch(&tbl8[((e[i] & ~DIR24_EXT) << 8) | (a[i] & 0xff)]);
+        }
+        for (size_t i = 0; i < m; i++) {
+            if (e[i] & DIR24_EXT)
+                e[i] = tbl8[((e[i] & ~DIR24_EXT) << 8) | (a[i] & 0xff)];
+            out[base + i] = e[i] ? &values[e[i]] : NULL;
+        }
+    }
+}
+
+bool
+Dir24::save(FILE *f, uint64_t *count) {
+    count[0] = ntbl8;
+    count[1] = nvalues;
+    return snap_write(f, tbl24, TBL24_SIZE * sizeof(uint32_t)) and
+           snap_write(f, tbl8, ntbl8 * sizeof(uint32_t)) and
+           snap_write(f, values, nvalues * sizeof(int));
+}
+
+bool
+Dir24::attach(const char **p, const char *end, const uint64_t *count) {
+    ntbl8 = count[0];
+    nvalues = count[1];
+    tbl24 = (uint32_t *) snap_map(p, end, TBL24_SIZE * sizeof(uint32_t));
+    tbl8 = (uint32_t *) snap_map(p, end, ntbl8 * sizeof(uint32_t));
+    values = (int *) snap_map(p, end, nvalues * sizeof(int));
+    mapped = true;
+    return tbl24 and tbl8 and values;
+}
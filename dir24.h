@@ -0,0 +1,66 @@
+/****************************************************************************
+   Program:     $Id: $
+   Date:        $Date: $
+   Description: flattened DIR-24-8 IPv4 longest-prefix match table
+****************************************************************************/
+
+#ifndef DIR24_H
+#define DIR24_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <arpa/inet.h>
+#include <vector>
+
+class Patricia;
+
+/* tbl24 entry: index into values, or (with DIR24_EXT) a tbl8 group */
+#define DIR24_EXT 0x80000000
+/* addresses resolved together by the batched get() */
+#define DIR24_BATCH 64
+
+/*
+ * Read-only copy of an IPv4 Patricia trie, compiled after the BGP table and
+ * blocklist are loaded.  tbl24 is indexed by the top 24 bits of an address;
+ * prefixes longer than /24 expand their /24 into a 256-entry tbl8 group.
+ * Entries are codes of the matching prefix, indexing a table of its trie
+ * value (ASN, or 0 for blocked); code 0 means no route.  A lookup is one or
+ * two array reads.
+ */
+class Dir24 {
+  public:
+  Dir24();
+  ~Dir24();
+  void build(Patricia *tree);
+  /* snapshot sections; attach() points into a mapped snapshot */
+  bool save(FILE *f, uint64_t *count);
+  bool attach(const char **p, const char *end, const uint64_t *count);
+  /* Trie value of the longest matching prefix, or NULL; addr in network order */
+  inline int *get(uint32_t addr) {
+    uint32_t a = ntohl(addr);
+    uint32_t e = tbl24[a >> 8];
+    if (e & DIR24_EXT)
+      e = tbl8[((e & ~DIR24_EXT) << 8) | (a & 0xff)];
+    return e ? &values[e] : NULL;
+  }
+  /* get() of n addresses, each table level prefetched across the batch */
+  void get(const uint32_t *addrs, size_t n, int **out);
+  uint32_t groups() { return ntbl8 >> 8; }
+  /* code of the prefix whose value get() returned, and one past the last */
+  uint32_t code(const int *value) { return value - values; }
+  uint32_t codes() { return nvalues; }
+  /* trie value of a code */
+  int value(uint32_t code) { return values[code]; }
+
+  private:
+  uint32_t *tbl24;
+  uint32_t *tbl8;
+  int *values;
+  uint64_t ntbl8;
+  uint64_t nvalues;
+  bool mapped;
+  std::vector<uint32_t> tbl8v;  /* storage, when built here */
+  std::vector<int> valuesv;
+};
+
+#endif /* DIR24_H */
@@ -7,7 +7,7 @@
 
 ICMP::ICMP() : 
    rtt(0), ttl(0), type(0), code(0), length(0), quote_p(0), sport(0), dport(0), ipid(0),
-   probesize(0), replysize(0), replyttl(0), replytos(0)
+   probesize(0), replysize(0), replyttl(0), replytos(0), attempt(-1)
 {
     gettimeofday(&tv, NULL);
     mpls_stack = NULL;
@@ -352,7 +352,10 @@ void ICMP::write(FILE ** out, uint32_t count, char *src, char *target) {
     fprintf(*out, "%d %d %d %d ",
         probesize, replysize, replyttl, replytos);
     fprintf(*out, "%s ", getMPLS());
-    fprintf(*out, "%d\n", count);
+    if (attempt >= 0)
+        fprintf(*out, "%d %d\n", count, attempt);
+    else
+        fprintf(*out, "%d\n", count);
 }
 
 void ICMP4::write(FILE ** out, uint32_t count) {
@@ -25,6 +25,8 @@ class ICMP {
     virtual struct in6_addr *getSrc6() { return NULL; };
     virtual uint32_t quoteDst() { return 0; };
     virtual struct in6_addr quoteDst6() { struct in6_addr a; return a; };
+    virtual uint32_t getTarget() { return 0; };
+    virtual struct in6_addr *getTarget6() { return NULL; };
     void printterse(char *);
     uint8_t quoteTTL() { return ttl; }
     uint32_t getRTT() { return rtt; }
@@ -32,6 +34,8 @@ class ICMP {
     uint16_t getSport() { return sport; }
     uint16_t getDport() { return dport; }
     uint8_t  getInstance() { return instance; }
+    uint8_t  getType() { return type; }
+    void setAttempt(int _attempt) { attempt = _attempt; }
     void print(char *, char *, int);
     void write(FILE **, uint32_t, char *, char *);
     char *getMPLS();
@@ -54,6 +58,7 @@ class ICMP {
     uint8_t replytos;
     struct timeval tv;
     bool coarse;
+    int attempt;  /* retry pass the probe was sent in, or -1 */
     mpls_label_t *mpls_stack;
 };
 
@@ -61,6 +66,7 @@ class ICMP4 : public ICMP {
     public:
     ICMP4(struct ip *, struct icmp *, uint32_t elapsed, bool _coarse);
     uint32_t quoteDst();
+    uint32_t getTarget() { return quote ? quote->ip_dst.s_addr : 0; }
     uint32_t getSrc() { return ip_src.s_addr; }
     void print();
     void write(FILE **, uint32_t);
@@ -75,6 +81,7 @@ class ICMP6 : public ICMP {
     ICMP6(struct ip6_hdr *, struct icmp6_hdr *, uint32_t elapsed, bool _coarse);
     struct in6_addr *getSrc6() { return &ip_src; }
     struct in6_addr quoteDst6();
+    struct in6_addr *getTarget6() { return yarrp_target; }
     void print();
     void write(FILE **, uint32_t);
 
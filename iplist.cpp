@@ -2,16 +2,17 @@
 #include "random_list.h"
 
 IPList::IPList(uint8_t _maxttl, bool _rand, bool _entire) : seeded(false) {
-  perm = NULL;
+  routes = NULL;
+  ownroutes = false;
   permsize = 0;
+  seq_pos = 0;
+  seq_start = 0;
+  seq_end = UINT64_MAX;
   maxttl = _maxttl;
   ttlbits = intlog(maxttl);
   ttlmask = 0xffffffff >> (32 - ttlbits);
-  ttlprefix = ttlmask ^ 0xff;
   rand = _rand;
   entire = _entire;
-  if (entire) 
-    permsize = UINT32_MAX;
   memset(key, 0, KEYLEN);
 }
 
@@ -20,44 +21,227 @@ void IPList::setkey(int seed) {
     permseed(key, seed);
 }
 
+IPList::~IPList() {
+  if (ownroutes)
+    delete routes;
+}
+
+/* Use the routed index of another list, e.g. one per sending thread */
+void IPList::share(IPList *list) {
+  routes = list->routes;
+  permsize = list->permsize;
+}
+
 IPList4::~IPList4() {
   targets.clear();
-  cperm_destroy(perm);
 }
 
 IPList6::~IPList6() {
   targets.clear();
-  cperm_destroy(perm);
+}
+
+/* Entire mode probes one address per /24, with the host octet derived from the
+   network octets so that every TTL of a /24 goes to the same destination */
+static uint32_t entire_target(uint32_t net24) {
+  uint32_t host = ((net24 >> 16) + (net24 >> 8) + net24) & 0xFF;
+  return (net24 << 8) | host;
+}
+
+static bool entire_routed(Patricia *tree, uint64_t net24) {
+  int *asn = (int *) tree->get(htonl(entire_target(net24)));
+  return asn and *asn != 0;
+}
+
+/* Entire mode: permute over routed, non-blocked /24s only */
+void IPList4::routed(Patricia *tree) {
+  routes = new RoutedIndex();
+  ownroutes = true;
+  routes->build(tree, 32, 24, entire_routed);
+  if (routes->count() == 0)
+    fatal("No routed /24s in BGP table");
+  permsize = routes->count() << ttlbits;
+}
+
+/* IPv6 entire mode probes one address per /48.  As for IPv4, the interface
+   identifier is derived from the prefix, so all TTLs share a destination. */
+static void entire6_target(uint64_t net48, struct in6_addr *addr) {
+  uint64_t high = net48 << 16;
+
+  memset(addr, 0, sizeof(struct in6_addr));
+  addr->s6_addr32[0] = htonl(high >> 32);
+  addr->s6_addr32[1] = htonl(high & 0xFFFFFFFF);
+  addr->s6_addr32[3] = (addr->s6_addr[0] + addr->s6_addr[1]) << 5;
+  addr->s6_addr32[3] += addr->s6_addr[4];
+  addr->s6_addr[15] = addr->s6_addr[2] + addr->s6_addr[3] + 100;
+}
+
+static bool entire6_routed(Patricia *tree, uint64_t net48) {
+  struct in6_addr addr;
+  entire6_target(net48, &addr);
+  int *asn = (int *) tree->get(addr);
+  return asn and *asn != 0;
+}
+
+/* Entire mode: permute over routed, non-blocked /48s only */
+void IPList6::routed(Patricia *tree) {
+  routes = new RoutedIndex();
+  ownroutes = true;
+  routes->build(tree, 64, 48, entire6_routed);
+  if (routes->count() == 0)
+    fatal("No routed /48s in BGP table");
+  permsize = routes->count() << ttlbits;
+}
+
+/* Orders target indices by the targets' addresses */
+struct by_addr4 {
+  const std::vector<uint32_t> &targets;
+  by_addr4(const std::vector<uint32_t> &t) : targets(t) {};
+  bool operator()(uint32_t a, uint32_t b) const { return targets[a] < targets[b]; }
+};
+
+struct by_addr6 {
+  const std::vector<struct in6_addr> &targets;
+  by_addr6(const std::vector<struct in6_addr> &t) : targets(t) {};
+  bool operator()(uint32_t a, uint32_t b) const {
+    return memcmp(&targets[a], &targets[b], sizeof(struct in6_addr)) < 0;
+  }
+};
+
+/* Sort target indices by address, for index() */
+void IPList4::reverse() {
+  order.resize(targets.size());
+  for (uint32_t i = 0; i < order.size(); i++)
+    order[i] = i;
+  std::sort(order.begin(), order.end(), by_addr4(targets));
+}
+
+void IPList6::reverse() {
+  order.resize(targets.size());
+  for (uint32_t i = 0; i < order.size(); i++)
+    order[i] = i;
+  std::sort(order.begin(), order.end(), by_addr6(targets));
+}
+
+/* Unit of target addr: its routed /24 in entire mode, else its index */
+bool IPList4::index(uint32_t addr, uint64_t *unit) {
+  if (entire) {
+    uint32_t host = ntohl(addr);
+    return entire_target(host >> 8) == host and routes->index(host >> 8, unit);
+  }
+  size_t lo = 0, hi = order.size();
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (targets[order[mid]] < addr)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == order.size() or targets[order[lo]] != addr)
+    return false;
+  *unit = order[lo];
+  return true;
+}
+
+bool IPList6::index(const struct in6_addr *addr, uint64_t *unit) {
+  if (entire) {
+    struct in6_addr target;
+    uint64_t net48 = (((uint64_t) ntohl(addr->s6_addr32[0]) << 32) | ntohl(addr->s6_addr32[1])) >> 16;
+    entire6_target(net48, &target);
+    return memcmp(&target, addr, sizeof(struct in6_addr)) == 0 and routes->index(net48, unit);
+  }
+  size_t lo = 0, hi = order.size();
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (memcmp(&targets[order[mid]], addr, sizeof(struct in6_addr)) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == order.size() or memcmp(&targets[order[lo]], addr, sizeof(struct in6_addr)) != 0)
+    return false;
+  *unit = order[lo];
+  return true;
 }
 
 /* seed */
 void IPList4::seed() {
-  PermMode mode = PERM_MODE_CYCLE;
-  if (not entire) {
+  if (entire) {
+    assert(routes and routes->count() > 0);
+  } else {
     assert(targets.size() > 0);
     permsize = targets.size() * maxttl;
-    if (permsize < 1000000) 
-      mode = PERM_MODE_PREFIX;
   } 
-  perm = cperm_create(permsize, mode, PERM_CIPHER_RC5, key, 16);
-  assert(perm);
+  perm.create(permsize, PERM_CIPHER_RC5, key, 16);
+  assert(perm.valid());
   seeded = true;
 }
 
 void IPList6::seed() {
-  PermMode mode = PERM_MODE_PREFIX;
-  assert(targets.size() > 0);
-  permsize = targets.size() * maxttl;
-  if (permsize > 5000000) {
-    mode = PERM_MODE_CYCLE;
-    std::cout << ">> Warning: reduced IPv6 performance with this many targets" <<  std::endl;
-    std::cout << ">>          use fewer targets, or lower max TTL (-m)" <<  std::endl;
+  if (entire) {
+    assert(routes and routes->count() > 0);
+  } else {
+    assert(targets.size() > 0);
+    permsize = targets.size() * maxttl;
   }
-  perm = cperm_create(permsize, mode, PERM_CIPHER_SPECK, key, 8);
-  assert(perm);
+  perm.create(permsize, PERM_CIPHER_SPECK, key, 8);
+  assert(perm.valid());
   seeded = true;
 }
 
+/* Index of the next target/ttl pair in scan order */
+uint64_t IPList::position() {
+  if (rand or entire)
+    return seeded ? perm.position() : 0;
+  return seq_pos;
+}
+
+/* Continue the scan from a previous position() */
+void IPList::seek(uint64_t pos) {
+  if (rand or entire) {
+    if (not seeded)
+      seed();
+    if (not perm.seek(pos))
+      fatal("Cannot seek to position %" PRIu64 " of %" PRIu64, pos, permsize);
+  } else {
+    seq_pos = pos;
+  }
+}
+
+/* Restrict the scan to the k-th of n contiguous slices of the index space */
+void IPList::shard(uint32_t k, uint32_t n, uint32_t t, uint32_t threads) {
+  uint64_t start = permsize / n * k + min((uint64_t)k, permsize % n);
+  uint64_t end = start + permsize / n + (k < permsize % n ? 1 : 0);
+
+  /* sending threads further split this instance's slice the same way */
+  if (threads > 1) {
+    uint64_t len = end - start;
+    start += len / threads * t + min((uint64_t)t, len % threads);
+    end = start + len / threads + (t < len % threads ? 1 : 0);
+  }
+  debug(LOW, ">> Shard " << k << "/" << n << " thread " << t << ": indices [" << start << ", " << end << ")");
+  if (rand or entire) {
+    if (not seeded)
+      seed();
+    perm.bounds(start, end);
+  } else {
+    seq_pos = seq_start = start;
+    seq_end = end;
+  }
+}
+
+/* Start the scan (or this slice of it) over, in an order keyed by seed */
+void IPList::rekey(uint32_t seed) {
+  if (rand or entire) {
+    if (not seeded)
+      this->seed();
+    setkey(seed);
+    if (not perm.rekey(key))
+      fatal("Cannot rekey permutation of size %" PRIu64, permsize);
+  } else {
+    seq_pos = seq_start;
+  }
+}
+
 /* Read list of input IPs */
 void IPList::read(char *in) {
   if (*in == '-') {
@@ -81,6 +265,7 @@ void IPList4::read(std::istream& inlist) {
       fatal("Couldn't parse IPv4 address: %s", line.c_str());
     targets.push_back(addr.s_addr);
   }
+  permsize = targets.size() * maxttl;
   debug(LOW, ">> IPv4 targets: " << targets.size());
 }
 
@@ -95,6 +280,7 @@ void IPList6::read(std::istream& inlist) {
       fatal("Couldn't parse IPv6 address: %s", line.c_str());
     targets.push_back(addr);
   }  
+  permsize = targets.size() * maxttl;
   debug(LOW, ">> IPv6 targets: " << targets.size());
 }
 
@@ -109,32 +295,25 @@ uint32_t IPList4::next_address(struct in_addr *in, uint8_t * ttl) {
 
 /* sequential next address */
 uint32_t IPList4::next_address_seq(struct in_addr *in, uint8_t * ttl) {
-  static std::vector<uint32_t>::iterator iter = targets.begin();
-  static uint32_t last_addr = *iter;
-  static uint8_t  last_ttl = 0;
-
-  if (last_ttl + 1 > maxttl) {
-    iter++;
-    if (iter == targets.end())
-      return 0;
-    last_ttl = 0;
-    last_addr = *(iter);
-  }
-  *ttl = last_ttl;
-  last_ttl+=1;
-  in->s_addr = last_addr;
+  uint64_t i = seq_pos / maxttl;
+
+  if (i >= targets.size() or seq_pos >= seq_end)
+    return 0;
+  *ttl = seq_pos % maxttl;
+  in->s_addr = targets[i];
+  seq_pos++;
   return 1;
 }
 
 /* random next address */
 uint32_t IPList4::next_address_rand(struct in_addr *in, uint8_t * ttl) {
-  static uint64_t next = 0;
-  static uint32_t next32 = 0;
+  uint64_t next = 0;
+  uint32_t next32;
 
   if (not seeded)
     seed();
 
-  if (PERM_END == cperm_next(perm, &next))
+  if (not perm.next(&next))
     return 0;
   next32 = next % 0xffffffff;
   in->s_addr = targets[next32 >> ttlbits];
@@ -147,31 +326,22 @@ uint32_t IPList4::next_address_rand(struct in_addr *in, uint8_t * ttl) {
 
 /* Internet-wide scanning mode */
 uint32_t IPList4::next_address_entire(struct in_addr *in, uint8_t * ttl) {
-  static uint64_t next = 0;
-  static uint32_t next32 = 0;
-  static uint32_t host;
-  static char *p;
+  uint64_t next = 0;
 
   if (not seeded)
     seed();
 
-  p = (char *) &next;
-  while (PERM_END != cperm_next(perm, &next)) {
-    next32 = next % 0xffffffff;
-    *ttl = next32 >> 24;            // use remaining 8 bits of perm as ttl
-    if ( (*ttl & ttlprefix) != 0x0) { // fast check: ttls in [0,31]
-      continue;
-    }
-    in->s_addr = next32 & 0x00FFFFFF;    // pick out 24 bits of network
-    host = (p[0] + p[1] + p[2]) & 0xFF;
-    in->s_addr += (host << 24);
-    return 1;
-  }
-  return 0;
+  if (not perm.next(&next))
+    return 0;
+  *ttl = (ttlbits == 0) ? 0 : (next & ttlmask);
+  in->s_addr = htonl(entire_target(routes->unit(next >> ttlbits)));
+  return 1;
 }
 
 uint32_t IPList6::next_address(struct in6_addr *in, uint8_t * ttl) {
-  if (rand) 
+  if (entire)
+    return next_address_entire(in, ttl);
+  else if (rand) 
     return next_address_rand(in, ttl);
   else
     return next_address_seq(in, ttl);
@@ -179,36 +349,41 @@ uint32_t IPList6::next_address(struct in6_addr *in, uint8_t * ttl) {
 
 /* sequential next address */
 uint32_t IPList6::next_address_seq(struct in6_addr *in, uint8_t * ttl) {
-  static std::vector<struct in6_addr>::iterator iter = targets.begin();
-  static struct in6_addr last_addr = *iter;
-  static uint8_t  last_ttl = 0;
-  int i;
-
-  if (last_ttl + 1 > maxttl) {
-    iter++;
-    if (iter == targets.end())
-      return 0;
-    last_ttl = 0;
-    last_addr = *(iter);
-  }
-  *ttl = last_ttl;
-  for(i = 0; i < 16; i++)
-    in->s6_addr[i] = last_addr.s6_addr[i];
-  last_ttl+=1;
+  uint64_t i = seq_pos / maxttl;
+
+  if (i >= targets.size() or seq_pos >= seq_end)
+    return 0;
+  *ttl = seq_pos % maxttl;
+  *in = targets[i];
+  seq_pos++;
   return 1;
 }
 
 /* random next address */
 uint32_t IPList6::next_address_rand(struct in6_addr *in, uint8_t * ttl) {
-  static uint64_t next = 0;
+  uint64_t next = 0;
 
   if (not seeded)
     seed();
 
-  if (PERM_END == cperm_next(perm, &next))
+  if (not perm.next(&next))
     return 0;
 
   *in = targets[next >> ttlbits];
   *ttl = (next & ttlmask);
   return 1;
 }
+
+/* Internet-wide scanning mode */
+uint32_t IPList6::next_address_entire(struct in6_addr *in, uint8_t * ttl) {
+  uint64_t next = 0;
+
+  if (not seeded)
+    seed();
+
+  if (not perm.next(&next))
+    return 0;
+  *ttl = (ttlbits == 0) ? 0 : (next & ttlmask);
+  entire6_target(routes->unit(next >> ttlbits), in);
+  return 1;
+}
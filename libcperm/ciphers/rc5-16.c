@@ -36,6 +36,12 @@
 
 #include "rc5-16.h"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #if _MSC_VER < 1600
 #define	inline	__inline
 #endif
@@ -153,6 +159,109 @@ void rc5_ecb_decrypt(const struct rc5_key *ks, void *srcv, void *dstv)
 #undef S
 }
 
+/*
+ * Batched encryption.  RC5 rotates by data-dependent amounts, so each lane
+ * needs its own rotate count.  AVX2 keeps one 16-bit word per 32-bit lane and
+ * uses the variable shifts; SSE2 keeps 8 words per register and composes the
+ * rotate from conditional rotates by 1, 2, 4 and 8.
+ */
+static inline void rc5_encrypt_word(const struct rc5_key *ks, uint32_t src, uint32_t *dst)
+{
+#define S(i) (ks->S[i])
+	RC5_WORD A = (src & 0xFFFF) + S(0);
+	RC5_WORD B = (src >> 16) + S(1);
+	int i;
+
+	for(i = 1; i <= R; i++) {
+		A = rol(A^B, B) + S(2*i);
+		B = rol(B^A, A) + S(2*i+1);
+	}
+	*dst = (uint32_t)A | ((uint32_t)B << 16);
+#undef S
+}
+
+#if defined(__AVX2__)
+
+#define RC5_LANES 8
+
+static inline __m256i rol_avx2(__m256i x, __m256i n)
+{
+	__m256i c = _mm256_and_si256(n, _mm256_set1_epi32(WSZ-1));
+	return _mm256_or_si256(_mm256_sllv_epi32(x, c),
+		_mm256_srlv_epi32(x, _mm256_sub_epi32(_mm256_set1_epi32(WSZ), c)));
+}
+
+static void rc5_encrypt_lanes(const struct rc5_key *ks, const uint32_t *src, uint32_t *dst)
+{
+	const __m256i mask = _mm256_set1_epi32(0xFFFF);
+	__m256i v = _mm256_loadu_si256((const __m256i *)src);
+	__m256i A = _mm256_and_si256(_mm256_add_epi32(_mm256_and_si256(v, mask), _mm256_set1_epi32(ks->S[0])), mask);
+	__m256i B = _mm256_and_si256(_mm256_add_epi32(_mm256_srli_epi32(v, 16), _mm256_set1_epi32(ks->S[1])), mask);
+	int i;
+
+	for(i = 1; i <= R; i++) {
+		A = rol_avx2(_mm256_xor_si256(A, B), B);
+		A = _mm256_and_si256(_mm256_add_epi32(A, _mm256_set1_epi32(ks->S[2*i])), mask);
+		B = rol_avx2(_mm256_xor_si256(B, A), A);
+		B = _mm256_and_si256(_mm256_add_epi32(B, _mm256_set1_epi32(ks->S[2*i+1])), mask);
+	}
+	_mm256_storeu_si256((__m256i *)dst, _mm256_or_si256(A, _mm256_slli_epi32(B, 16)));
+}
+
+#elif defined(__SSE2__)
+
+#define RC5_LANES 8
+
+/* x = bit k of n set ? rol(x, k) : x */
+#define ROL_STEP(x, n, k) do { \
+	__m128i m = _mm_cmpeq_epi16(_mm_and_si128(n, _mm_set1_epi16(k)), _mm_set1_epi16(k)); \
+	__m128i r = _mm_or_si128(_mm_slli_epi16(x, k), _mm_srli_epi16(x, WSZ-k)); \
+	x = _mm_or_si128(_mm_and_si128(m, r), _mm_andnot_si128(m, x)); \
+} while(0)
+
+static inline __m128i rol_sse2(__m128i x, __m128i n)
+{
+	ROL_STEP(x, n, 1);
+	ROL_STEP(x, n, 2);
+	ROL_STEP(x, n, 4);
+	ROL_STEP(x, n, 8);
+	return x;
+}
+
+static void rc5_encrypt_lanes(const struct rc5_key *ks, const uint32_t *src, uint32_t *dst)
+{
+	__m128i v0 = _mm_loadu_si128((const __m128i *)src);
+	__m128i v1 = _mm_loadu_si128((const __m128i *)(src + 4));
+	/* split into 16-bit A and B words; sign extension keeps packs exact */
+	__m128i A = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(v0, 16), 16),
+		_mm_srai_epi32(_mm_slli_epi32(v1, 16), 16));
+	__m128i B = _mm_packs_epi32(_mm_srai_epi32(v0, 16), _mm_srai_epi32(v1, 16));
+	int i;
+
+	A = _mm_add_epi16(A, _mm_set1_epi16(ks->S[0]));
+	B = _mm_add_epi16(B, _mm_set1_epi16(ks->S[1]));
+	for(i = 1; i <= R; i++) {
+		A = _mm_add_epi16(rol_sse2(_mm_xor_si128(A, B), B), _mm_set1_epi16(ks->S[2*i]));
+		B = _mm_add_epi16(rol_sse2(_mm_xor_si128(B, A), A), _mm_set1_epi16(ks->S[2*i+1]));
+	}
+	_mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(A, B));
+	_mm_storeu_si128((__m128i *)(dst + 4), _mm_unpackhi_epi16(A, B));
+}
+
+#endif
+
+void rc5_ecb_encrypt_batch(const struct rc5_key *ks, const uint32_t *src, uint32_t *dst, int n)
+{
+	int i = 0;
+
+#ifdef RC5_LANES
+	for(; i + RC5_LANES <= n; i += RC5_LANES)
+		rc5_encrypt_lanes(ks, src + i, dst + i);
+#endif
+	for(; i < n; i++)
+		rc5_encrypt_word(ks, src[i], &dst[i]);
+}
+
 #ifdef RC5_TEST
 
 #include <stdio.h>
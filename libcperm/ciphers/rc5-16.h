@@ -37,6 +37,8 @@
 #define RC5_KEYLEN	16			/* (bytes) */
 #define RC5_ROUNDS	12			/* # of rounds */
 
+#include <stdint.h>
+
 typedef unsigned short RC5_WORD;
 
 struct rc5_key {
@@ -56,4 +58,11 @@ void rc5_ecb_encrypt(const struct rc5_key *ks, void *src, void *dst);
 /** Decrypt a single block.  It is allowed that src == dst. */
 void rc5_ecb_decrypt(const struct rc5_key *ks, void *src, void *dst);
 
+/**
+ * Encrypt n blocks, each held in a 32-bit word (low half is A, high half is
+ * B).  Uses AVX2 or SSE2 when the compiler targets them, otherwise a portable
+ * loop.  It is allowed that src == dst.
+ */
+void rc5_ecb_encrypt_batch(const struct rc5_key *ks, const uint32_t *src, uint32_t *dst, int n);
+
 #endif	/* RC5_16_H__ */
@@ -62,6 +62,24 @@ int perm_rc5_enc(struct cperm_t* perm, uint32_t pt, uint32_t* ct) {
 	return 0;
 }
 
+int perm_rc5_enc_batch(struct cperm_t* perm, const uint64_t* pt, uint64_t* ct, int n) {
+	struct rc5_data* d = perm->cipher_data;
+	uint32_t in[CPERM_BATCH_MAX], out[CPERM_BATCH_MAX];
+	int i, j, k;
+
+	for(i = 0; i < n; i += k) {
+		k = (n - i < CPERM_BATCH_MAX) ? n - i : CPERM_BATCH_MAX;
+		for(j = 0; j < k; j++) {
+			in[j] = (uint32_t) pt[i + j];
+		}
+		rc5_ecb_encrypt_batch(&d->key, in, out, k);
+		for(j = 0; j < k; j++) {
+			ct[i + j] = out[j];
+		}
+	}
+	return 0;
+}
+
 int perm_rc5_dec(struct cperm_t* perm, uint32_t ct, uint32_t* pt) {
 	struct rc5_data* d = perm->cipher_data;
 	rc5_ecb_decrypt(&d->key, &ct, pt);
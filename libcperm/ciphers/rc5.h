@@ -40,6 +40,7 @@ struct rc5_data {
 int perm_rc5_create(struct cperm_t* pt);
 int perm_rc5_destroy(struct cperm_t* pt);
 int perm_rc5_enc(struct cperm_t* perm, uint64_t pt, uint64_t* ct);
+int perm_rc5_enc_batch(struct cperm_t* perm, const uint64_t* pt, uint64_t* ct, int n);
 int perm_rc5_dec(struct cperm_t* perm, uint64_t ct, uint64_t* pt);
 
 #endif /* RC5_H */
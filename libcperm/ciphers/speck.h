@@ -87,10 +87,15 @@ void speck_decrypt(SPECK_TYPE const ct[static 2], SPECK_TYPE pt[static 2], SPECK
 void speck_encrypt_combined(SPECK_TYPE const pt[static 2], SPECK_TYPE ct[static 2], SPECK_TYPE const K[static SPECK_KEY_LEN]);
 void speck_decrypt_combined(SPECK_TYPE const ct[static 2], SPECK_TYPE pt[static 2], SPECK_TYPE const K[static SPECK_KEY_LEN]);
 
+#ifdef SPECK_32_64
+void speck_encrypt_batch(const uint32_t *pt, uint32_t *ct, int n, SPECK_TYPE const K[static SPECK_ROUNDS]);
+#endif
+
 int perm_speck_create(struct cperm_t *pt);
 int perm_speck_destroy(struct cperm_t* pt);
 int perm_speck_enc(struct cperm_t* perm, uint64_t pt, uint64_t* ct);
 int perm_speck_dec(struct cperm_t* perm, uint64_t ct, uint64_t* pt);
+int perm_speck_enc_batch(struct cperm_t* perm, const uint64_t* pt, uint64_t* ct, int n);
 
 #ifdef __cplusplus
 }
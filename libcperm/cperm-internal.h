@@ -30,13 +30,20 @@
 typedef int (*ModeCreateFunc)(struct cperm_t*);
 typedef int (*ModeNextFunc)(struct cperm_t*, uint64_t*);
 typedef int (*ModeGetFunc)(struct cperm_t*, uint64_t, uint64_t*);
+typedef int (*ModeNextBatchFunc)(struct cperm_t*, uint64_t*, int);
+typedef int (*ModeSeekFunc)(struct cperm_t*, uint64_t);
 typedef int (*ModeDestroyFunc)(struct cperm_t*);
 
 typedef int (*CipherCreateFunc)(struct cperm_t*);
 typedef int (*CipherEncFunc)(struct cperm_t*, uint64_t, uint64_t*);
 typedef int (*CipherDecFunc)(struct cperm_t*, uint64_t, uint64_t*);
+typedef int (*CipherEncBatchFunc)(struct cperm_t*, const uint64_t*, uint64_t*, int);
 typedef int (*CipherDestroyFunc)(struct cperm_t*);
 
+/* Largest number of blocks a mode hands to the cipher in one enc_batch() call.
+   Sizes the on-stack buffers used by the batch paths. */
+#define CPERM_BATCH_MAX	64
+
 /* libperm supports pluggable permutation modes and ciphers. They are defined by using
    ModeFuncs and CipherFuncs structures. */
 struct ModeFuncs {
@@ -45,6 +52,8 @@ struct ModeFuncs {
 	ModeNextFunc next;
 	ModeGetFunc get;
 	ModeDestroyFunc destroy;
+	ModeNextBatchFunc next_batch;	// Optional; cperm_next_batch() falls back to next()
+	ModeSeekFunc seek;				// Moves the next() index
 };
 
 struct CipherFuncs {
@@ -53,6 +62,7 @@ struct CipherFuncs {
 	CipherEncFunc enc;
 	CipherDecFunc dec;
 	CipherDestroyFunc destroy;
+	CipherEncBatchFunc enc_batch;	// Encrypts n blocks at once
 };
 
 /* struct perm_t
@@ -30,22 +30,36 @@
 #include "cperm-internal.h"
 #include "prefix.h"
 #include "cycle.h"
+#include "feistel.h"
 #include "ciphers/rc5.h"
 #include "ciphers/speck.h"
 
 int cperm_errno = 0;
 
+/* Cycle mode encrypts 32-bit blocks and discards those outside the range, so it
+   is only selected automatically when the range fills most of the block. */
+#define CYCLE_AUTO_MIN	((uint64_t)1 << 31)
+#define CYCLE_AUTO_MAX	((uint64_t)1 << 32)
+
+static PermMode select_mode(uint64_t range) {
+	if(range > CYCLE_AUTO_MIN && range <= CYCLE_AUTO_MAX) {
+		return PERM_MODE_CYCLE;
+	}
+	return PERM_MODE_FEISTEL;
+}
+
 /* List of available cpermutation modes. Each mode has an identifier, and four functions. See ModeFuncs struct for description of the fields. */
 static struct ModeFuncs available_modes[] = {
-	{ PERM_MODE_PREFIX,		perm_prefix_create,	perm_prefix_next,	perm_prefix_get,	perm_prefix_destroy },
-	{ PERM_MODE_CYCLE,		perm_cycle_create,	perm_cycle_next,	perm_cycle_get,		perm_cycle_destroy },
+	{ PERM_MODE_PREFIX,		perm_prefix_create,	perm_prefix_next,	perm_prefix_get,	perm_prefix_destroy,	perm_prefix_next_batch,		perm_prefix_seek },
+	{ PERM_MODE_CYCLE,		perm_cycle_create,	perm_cycle_next,	perm_cycle_get,		perm_cycle_destroy,		perm_cycle_next_batch,		perm_cycle_seek },
+	{ PERM_MODE_FEISTEL,	perm_feistel_create,	perm_feistel_next,	perm_feistel_get,	perm_feistel_destroy,	perm_feistel_next_batch,	perm_feistel_seek },
 	{ PERM_MODE_ERROR,		NULL,					NULL }
 };
 
 /* List of available ciphers. Each cipher has an identifier, and four functions. See CipherFuncs struct for description of the fields. */
 static struct CipherFuncs available_ciphers[] = {
-	{ PERM_CIPHER_RC5,		perm_rc5_create,	perm_rc5_enc,		perm_rc5_dec,		perm_rc5_destroy },
-	{ PERM_CIPHER_SPECK,		perm_speck_create,	perm_speck_enc,		perm_speck_dec,		perm_speck_destroy },
+	{ PERM_CIPHER_RC5,		perm_rc5_create,	perm_rc5_enc,		perm_rc5_dec,		perm_rc5_destroy,	perm_rc5_enc_batch },
+	{ PERM_CIPHER_SPECK,		perm_speck_create,	perm_speck_enc,		perm_speck_dec,		perm_speck_destroy,	perm_speck_enc_batch },
 	{ PERM_CIPHER_ERROR,		NULL,			NULL,   NULL },
 };
 
@@ -58,6 +72,13 @@ struct cperm_t* cperm_create(uint64_t range, PermMode m, PermCipher a, uint8_t*
 
 	perm->range = range;
 
+	if(m == PERM_MODE_AUTO) {
+		m = select_mode(range);
+	}
+	if(a == PERM_CIPHER_AUTO) {
+		a = PERM_CIPHER_RC5;
+	}
+
 	/* Locate the selected mode and initialize function pointers */
 	struct ModeFuncs* mf = available_modes;
 	while(mf->mode != PERM_MODE_ERROR) {
@@ -82,6 +103,11 @@ struct cperm_t* cperm_create(uint64_t range, PermMode m, PermCipher a, uint8_t*
 		}
 		cf++;
 	}
+	if(perm->cipher == NULL) {
+		free(perm);
+		cperm_errno = PERM_ERROR_CIPHER_NOT_SUPP;
+		return NULL;
+	}
 
 	/* Set the cipher key */
 	cperm_set_key(perm, key, key_len);
@@ -133,6 +159,27 @@ int cperm_next(struct cperm_t* perm, uint64_t* ct) {
 	return perm->mode->next(perm, ct);
 }
 
+int cperm_next_batch(struct cperm_t* perm, uint64_t* ct, int n) {
+	int count = 0;
+
+	if(!perm) { return PERM_ERROR_BAD_HANDLE; }
+	if(n <= 0) { return 0; }
+
+	if(perm->mode->next_batch) {
+		count = perm->mode->next_batch(perm, ct, n);
+	} else {
+		while(count < n && perm->mode->next(perm, &ct[count]) == 0) {
+			count++;
+		}
+	}
+	if(count <= 0) {
+		cperm_errno = PERM_END;
+		return PERM_END;
+	}
+	perm->position += count;
+	return count;
+}
+
 int cperm_enc(struct cperm_t* perm, uint64_t pt, uint64_t* ct) {
 	if(!perm) { return PERM_ERROR_BAD_HANDLE; }
 	return perm->mode->get(perm, pt, ct);
@@ -146,11 +193,24 @@ int cperm_get_last_error() {
 	return cperm_errno;
 }
 
+int cperm_seek(struct cperm_t* perm, uint64_t position) {
+	if(!perm) { return PERM_ERROR_BAD_HANDLE; }
+	if(position > perm->range) {
+		cperm_errno = PERM_ERROR_RANGE;
+		return PERM_ERROR_RANGE;
+	}
+
+	perm->mode->seek(perm, position);
+	perm->position = position;
+	return 0;
+}
+
 int cperm_reset(struct cperm_t* perm) {
 	if(!perm) { return PERM_ERROR_BAD_HANDLE; }
 
 	perm->mode->destroy(perm);
 	perm->mode->create(perm);
+	perm->position = 0;
 	return 1;
 }
 
@@ -62,7 +62,7 @@ typedef enum {	PERM_MODE_ERROR = -1,
 				PERM_MODE_AUTO,				/**< Automatically select the mode to use based on permutation size */
 				PERM_MODE_PREFIX,			/**< Use prefix cipher mode */
 				PERM_MODE_CYCLE,			/**< Use cycle walking mode */
-				PERM_MODE_FEISTEL			/**< Use Feistel mode (currently not implemented) */
+				PERM_MODE_FEISTEL			/**< Use Feistel mode (range-sized Feistel cipher with cycle walking) */
 } PermMode;
 
 typedef enum {	PERM_CIPHER_ERROR = -1,
@@ -83,7 +83,11 @@ extern int cperm_errno;
  * automatically using the @c PERM_MODE_AUTO option. The cipher to use is selected using the
  * @c cipher parameter or automatically selected using the @c PERM_CIPHER_AUTO option.
  *
- * @param range Size of the permutation. Maximum of 2^32.
+ * @c PERM_MODE_AUTO selects @c PERM_MODE_CYCLE when the range is between 2^31 and 2^32, and
+ * @c PERM_MODE_FEISTEL otherwise. Feistel mode uses constant memory and supports any range
+ * up to 2^64 - 1; prefix mode materializes the whole permutation in memory.
+ *
+ * @param range Size of the permutation. Maximum of 2^32 for @c PERM_MODE_CYCLE.
  * @param mode Permutation generation mode to use.
  * @param cipher Cipher to use.
  * @param key Cipher key.
@@ -118,12 +122,28 @@ int cperm_set_key(struct cperm_t* perm, const unsigned char* key, uint16_t lengt
  */
 int cperm_next(struct cperm_t* p, uint64_t* ct);
 
+/**
+ * @brief Get the next @p n items in the permutation.
+ *
+ * Equivalent to calling @c cperm_next up to @p n times, but the underlying cipher is
+ * evaluated on a whole batch of indices at once (using SSE2/AVX2 kernels when the
+ * library is built for them). The items returned are the same, in the same order,
+ * as successive @c cperm_next calls would produce.
+ *
+ * @param p Permutation object
+ * @param ct Array of at least @p n integers to store the permutation values
+ * @param n Maximum number of items to return
+ *
+ * @return Number of items stored (less than @p n only at the end of the permutation)
+ * or @c PERM_END when there are no more items.
+ */
+int cperm_next_batch(struct cperm_t* p, uint64_t* ct, int n);
+
 /**
  * @brief Encodes an index to its permuted value.
  *
- * Note: This API call is not supported on all permutation modes. At present, this
- * function is only supported when using @c PERM_MODE_PREFIX. Calling this function
- * when using a different mode will return @c PERM_ERROR_OP_NOT_SUPP.
+ * Supported by all permutation modes. The value returned for index @c i is the @c i-th
+ * value that @c cperm_next produces.
  *
  * @param p The permutation object
  * @param pt Index within the permutation
@@ -133,6 +153,20 @@ int cperm_next(struct cperm_t* p, uint64_t* ct);
  */
 int cperm_enc(struct cperm_t* perm, uint64_t pt, uint64_t* ct);
 
+/**
+ * @brief Moves the permutation to the given position.
+ *
+ * The next call to @c cperm_next returns the value at index @p position, exactly as if
+ * @p position values had already been read. Together with @c cperm_get_position this
+ * allows a long-running permutation to be checkpointed and resumed.
+ *
+ * @param p The permutation object
+ * @param position New position, between 0 and the range of the permutation
+ *
+ * @return 0 on success or @c PERM_ERROR_RANGE if @p position is beyond the range.
+ */
+int cperm_seek(struct cperm_t* perm, uint64_t position);
+
 /**
  * @brief Returns the error status of the last API function.
  *
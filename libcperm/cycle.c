@@ -27,40 +27,106 @@
 #include "cperm-internal.h"
 #include "cycle.h"
 
+/* Cycle mode applies the 32-bit block cipher directly and cycle-walks: a value
+   that encrypts to a point outside the range is re-encrypted until it lands back
+   inside. Index i always maps to the same output, so the permutation supports
+   random access and seeking; the range is limited to the 2^32 block. */
+
 int perm_cycle_create(struct cperm_t* perm) {
-	struct cycle_data_t* cycle_data = calloc(1,sizeof(*cycle_data));
+	struct cycle_data_t* cycle_data;
+
+	if(perm->range > ((uint64_t)1 << 32)) {
+		cperm_errno = PERM_ERROR_RANGE;
+		return PERM_ERROR_RANGE;
+	}
+
+	cycle_data = calloc(1,sizeof(*cycle_data));
 	if(!cycle_data) {
 		cperm_errno = PERM_ERROR_NOMEM;
 		return PERM_ERROR_NOMEM;
 	}
 
 	cycle_data->next = 0;
-	cycle_data->count = 0;
 	perm->mode_data = cycle_data;
 
 	return 0;
 }
 
 int perm_cycle_get(struct cperm_t* perm, uint64_t pt, uint64_t* ct) {
-	cperm_errno = PERM_ERROR_OP_NOT_SUPP;
-	return PERM_ERROR_OP_NOT_SUPP;
+	uint64_t x = pt;
+
+	if(pt >= perm->range) {
+		cperm_errno = PERM_ERROR_RANGE;
+		return PERM_ERROR_RANGE;
+	}
+
+	/* enc() only writes the low 32 bits */
+	do {
+		*ct = 0;
+		perm->cipher->enc(perm, x, ct);
+		x = *ct;
+	} while(*ct >= perm->range);
+
+	return 0;
 }
 
 int perm_cycle_next(struct cperm_t* perm, uint64_t* ct) {
 	struct cycle_data_t* cycle_data = perm->mode_data;
 
-	if(cycle_data->count >= perm->range) {
+	if(cycle_data->next >= perm->range) {
 		cperm_errno = PERM_END;
 		return PERM_END;
 	}
 
-	do {
-		perm->cipher->enc(perm, cycle_data->next, ct);
-		cycle_data->next++;
-	}while(*ct >= perm->range);
+	return perm_cycle_get(perm, cycle_data->next++, ct);
+}
+
+/* Encrypts runs of consecutive indices with the batch cipher, then walks the
+   out-of-range results together until every one has landed. */
+int perm_cycle_next_batch(struct cperm_t* perm, uint64_t* ct, int n) {
+	struct cycle_data_t* cycle_data = perm->mode_data;
+	uint64_t walk[CPERM_BATCH_MAX];
+	int slot[CPERM_BATCH_MAX];
+	int count = 0;
+	int i, k, m, w;
+
+	if(perm->range - cycle_data->next < (uint64_t)n) {
+		n = perm->range - cycle_data->next;
+	}
 
-	cycle_data->count++;
+	while(count < n) {
+		k = (n - count < CPERM_BATCH_MAX) ? n - count : CPERM_BATCH_MAX;
+		for(i = 0; i < k; i++) {
+			ct[count + i] = cycle_data->next++;
+		}
+		perm->cipher->enc_batch(perm, &ct[count], &ct[count], k);
 
+		for(w = 0, i = 0; i < k; i++) {
+			if(ct[count + i] >= perm->range) {
+				slot[w] = count + i;
+				walk[w++] = ct[count + i];
+			}
+		}
+		while(w > 0) {
+			perm->cipher->enc_batch(perm, walk, walk, w);
+			for(m = w, w = 0, i = 0; i < m; i++) {
+				if(walk[i] >= perm->range) {
+					slot[w] = slot[i];
+					walk[w++] = walk[i];
+				} else {
+					ct[slot[i]] = walk[i];
+				}
+			}
+		}
+		count += k;
+	}
+
+	return count;
+}
+
+int perm_cycle_seek(struct cperm_t* perm, uint64_t position) {
+	struct cycle_data_t* cycle_data = perm->mode_data;
+	cycle_data->next = position;
 	return 0;
 }
 
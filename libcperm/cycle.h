@@ -28,12 +28,13 @@
 
 struct cycle_data_t {
 	uint64_t next;
-	uint64_t count;
 };
 
 int perm_cycle_create(struct cperm_t* perm);
 int perm_cycle_get(struct cperm_t* perm, uint64_t pt, uint64_t* ct);
 int perm_cycle_next(struct cperm_t* perm, uint64_t* ct);
+int perm_cycle_next_batch(struct cperm_t* perm, uint64_t* ct, int n);
+int perm_cycle_seek(struct cperm_t* perm, uint64_t position);
 int perm_cycle_destroy(struct cperm_t* perm);
 
 #endif /* CYCLE_H */
@@ -26,74 +26,186 @@
 #include "cperm.h"
 #include "cperm-internal.h"
 #include "feistel.h"
-#include "ciphers/rc5.h"
 
-int perm_feistel_create(struct perm_t* perm) {
-	struct feistel_data_t* feistel_data = malloc(sizeof(*feistel_data));
+/* Feistel mode builds a block cipher whose block size matches the width of the
+   permutation range, using the selected 32-bit cipher as the round function.
+   Values that land outside the range are cycle-walked (re-encrypted) until they
+   fall back inside. Because 2^(bits-1) < range <= 2^bits, fewer than two Feistel
+   encryptions are needed per output on average, regardless of the range. */
+
+static inline uint64_t mask(uint8_t bits) {
+	return (bits >= 64) ? UINT64_MAX : ((uint64_t)1 << bits) - 1;
+}
+
+static uint8_t range_bits(uint64_t range) {
+	uint8_t bits = 0;
+	/* smallest bits such that 2^bits >= range */
+	while(bits < 64 && ((uint64_t)1 << bits) < range) {
+		bits++;
+	}
+	if(bits < FEISTEL_MIN_BITS) {
+		bits = FEISTEL_MIN_BITS;
+	}
+	return bits;
+}
+
+static inline uint32_t round_function(struct cperm_t* perm, uint32_t tweak, uint64_t r) {
+	uint64_t ct = 0;
+	perm->cipher->enc(perm, (r ^ tweak) & 0xFFFFFFFF, &ct);
+	return (uint32_t)ct;
+}
+
+/* Unbalanced Feistel network over a bits-wide domain. After every round the
+   halves swap, so their widths swap too; an even number of rounds restores the
+   original split. */
+static uint64_t feistel_encrypt(struct cperm_t* perm, struct feistel_data_t* fd, uint64_t x) {
+	uint8_t lbits = fd->lbits;
+	uint8_t rbits = fd->rbits;
+	uint8_t tmpbits;
+	uint64_t l = x >> rbits;
+	uint64_t r = x & mask(rbits);
+	uint64_t tmp;
+
+	for(int i = 0; i < FEISTEL_ROUNDS; i++) {
+		tmp = (l ^ round_function(perm, fd->tweak[i], r)) & mask(lbits);
+		l = r;
+		r = tmp;
+		tmpbits = lbits;
+		lbits = rbits;
+		rbits = tmpbits;
+	}
+	return (l << rbits) | r;
+}
+
+/* Batched feistel_encrypt(): all blocks go through each round together, so the
+   round function is one enc_batch() call per round. */
+static void feistel_encrypt_batch(struct cperm_t* perm, struct feistel_data_t* fd, uint64_t* x, int n) {
+	uint8_t lbits = fd->lbits;
+	uint8_t rbits = fd->rbits;
+	uint8_t tmpbits;
+	uint64_t l[CPERM_BATCH_MAX], r[CPERM_BATCH_MAX], f[CPERM_BATCH_MAX];
+	uint64_t tmp;
+	int i, j;
+
+	for(j = 0; j < n; j++) {
+		l[j] = x[j] >> rbits;
+		r[j] = x[j] & mask(rbits);
+	}
+	for(i = 0; i < FEISTEL_ROUNDS; i++) {
+		for(j = 0; j < n; j++) {
+			f[j] = (r[j] ^ fd->tweak[i]) & 0xFFFFFFFF;
+		}
+		perm->cipher->enc_batch(perm, f, f, n);
+		for(j = 0; j < n; j++) {
+			tmp = (l[j] ^ (uint32_t)f[j]) & mask(lbits);
+			l[j] = r[j];
+			r[j] = tmp;
+		}
+		tmpbits = lbits;
+		lbits = rbits;
+		rbits = tmpbits;
+	}
+	for(j = 0; j < n; j++) {
+		x[j] = (l[j] << rbits) | r[j];
+	}
+}
+
+int perm_feistel_create(struct cperm_t* perm) {
+	struct feistel_data_t* feistel_data = calloc(1, sizeof(*feistel_data));
 	if(!feistel_data) {
-		perm_errno = PERM_ERROR_NOMEM;
-		return -1;
+		cperm_errno = PERM_ERROR_NOMEM;
+		return PERM_ERROR_NOMEM;
 	}
 
 	feistel_data->next = 0;
-	feistel_data->count = 0;
+	feistel_data->bits = range_bits(perm->range);
+	feistel_data->lbits = feistel_data->bits / 2;
+	feistel_data->rbits = feistel_data->bits - feistel_data->lbits;
+	for(int i = 0; i < FEISTEL_ROUNDS; i++) {
+		feistel_data->tweak[i] = (uint32_t)i * 0x9E3779B9;
+	}
 	perm->mode_data = feistel_data;
 
 	return 0;
 }
 
-int perm_feistel_get(struct perm_t* perm, uint32_t pt, uint32_t* ct) {
-	perm_errno = PERM_ERROR_RANGE;
-	return -1;
-}
-
-int perm_feistel_next(struct perm_t* perm, uint32_t* ct) {
+int perm_feistel_get(struct cperm_t* perm, uint64_t pt, uint64_t* ct) {
 	struct feistel_data_t* feistel_data = perm->mode_data;
 
-	c = fe(r, a, b);
-
-	if(feistel_data->count >= perm->range) {
-		perm_errno = PERM_END;
-		return PERM_END;
+	if(pt >= perm->range) {
+		cperm_errno = PERM_ERROR_RANGE;
+		return PERM_ERROR_RANGE;
 	}
 
+	/* Cycle walk: pt is in range, so its cycle returns to the range */
+	*ct = pt;
 	do {
-		perm_rc5_enc(perm, feistel_data->next, ct);
-		feistel_data->next++;
-	}while(*ct >= perm->range);
-
-	feistel_data->count++;
+		*ct = feistel_encrypt(perm, feistel_data, *ct);
+	} while(*ct >= perm->range);
 
 	return 0;
 }
 
-int perm_feistel_destroy(struct perm_t* perm) {
-	free(perm->mode_data);
-	return 0;
+int perm_feistel_next(struct cperm_t* perm, uint64_t* ct) {
+	struct feistel_data_t* feistel_data = perm->mode_data;
+
+	if(feistel_data->next >= perm->range) {
+		cperm_errno = PERM_END;
+		return PERM_END;
+	}
+
+	return perm_feistel_get(perm, feistel_data->next++, ct);
 }
 
-uint32_t fe(int r, int a, int b, int m) {
-	int L = m % a;
-	int R = m / a;
+int perm_feistel_next_batch(struct cperm_t* perm, uint64_t* ct, int n) {
+	struct feistel_data_t* feistel_data = perm->mode_data;
+	uint64_t walk[CPERM_BATCH_MAX];
+	int slot[CPERM_BATCH_MAX];
+	int count = 0;
+	int i, k, m, w;
 
-	for(int j = 0; j < r; j++) {
-		if(j % 2 == 1) {
-			tmp = L + F(R) % a;
-		} else {
-			tmp = L + F(R) % b;
-		}
-		L = R;
-		R = tmp;
+	if(perm->range - feistel_data->next < (uint64_t)n) {
+		n = perm->range - feistel_data->next;
 	}
-	if(r % 2 == 1) {
-		return a * L + R;
-	} else {
-		return a * R + L;
+
+	while(count < n) {
+		k = (n - count < CPERM_BATCH_MAX) ? n - count : CPERM_BATCH_MAX;
+		for(i = 0; i < k; i++) {
+			ct[count + i] = feistel_data->next++;
+		}
+		feistel_encrypt_batch(perm, feistel_data, &ct[count], k);
+
+		/* Cycle walk the out-of-range results together until all land */
+		for(w = 0, i = 0; i < k; i++) {
+			if(ct[count + i] >= perm->range) {
+				slot[w] = count + i;
+				walk[w++] = ct[count + i];
+			}
+		}
+		while(w > 0) {
+			feistel_encrypt_batch(perm, feistel_data, walk, w);
+			for(m = w, w = 0, i = 0; i < m; i++) {
+				if(walk[i] >= perm->range) {
+					slot[w] = slot[i];
+					walk[w++] = walk[i];
+				} else {
+					ct[slot[i]] = walk[i];
+				}
+			}
+		}
+		count += k;
 	}
+
+	return count;
 }
 
-uint32_t F(uint32_t pt) {
-	uint32_t ct;
-	perm->cipher->enc(perm, &v, &ct);
-	return ct;
+int perm_feistel_seek(struct cperm_t* perm, uint64_t position) {
+	struct feistel_data_t* feistel_data = perm->mode_data;
+	feistel_data->next = position;
+	return 0;
+}
+
+int perm_feistel_destroy(struct cperm_t* perm) {
+	free(perm->mode_data);
+	return 0;
 }
@@ -26,14 +26,26 @@
 #include <stdint.h>
 #include "cperm.h"
 
+/* Number of Feistel rounds. Must be even so the left/right halves end up
+   with the same widths they started with. */
+#define FEISTEL_ROUNDS	4
+
+/* Smallest domain width, in bits. Each half must be at least one bit wide. */
+#define FEISTEL_MIN_BITS	2
+
 struct feistel_data_t {
-	uint32_t next;
-	uint32_t count;
+	uint64_t next;					// Next index to encrypt
+	uint8_t bits;					// Width of the Feistel domain (2^bits >= range)
+	uint8_t lbits;					// Width of the left half
+	uint8_t rbits;					// Width of the right half
+	uint32_t tweak[FEISTEL_ROUNDS];	// Per-round tweaks, mixed into the round function input
 };
 
-int perm_feistel_create(struct perm_t* perm);
-int perm_feistel_get(struct perm_t* perm, uint32_t pt, uint32_t* ct);
-int perm_feistel_next(struct perm_t* perm, uint32_t* ct);
-int perm_feistel_destroy(struct perm_t* perm);
+int perm_feistel_create(struct cperm_t* perm);
+int perm_feistel_get(struct cperm_t* perm, uint64_t pt, uint64_t* ct);
+int perm_feistel_next(struct cperm_t* perm, uint64_t* ct);
+int perm_feistel_next_batch(struct cperm_t* perm, uint64_t* ct, int n);
+int perm_feistel_seek(struct cperm_t* perm, uint64_t position);
+int perm_feistel_destroy(struct cperm_t* perm);
 
 #endif /* FEISTEL_H */
@@ -87,6 +87,23 @@ int perm_prefix_next(struct cperm_t* perm, uint64_t* ct) {
 	return PERM_END;
 }
 
+int perm_prefix_next_batch(struct cperm_t* perm, uint64_t* ct, int n) {
+	struct prefix_data_t* prefix_data = perm->mode_data;
+	int count = 0;
+
+	while(count < n && prefix_data->next < perm->range) {
+		ct[count++] = prefix_data->vector[prefix_data->next++].pt;
+	}
+
+	return count;
+}
+
+int perm_prefix_seek(struct cperm_t* perm, uint64_t position) {
+	struct prefix_data_t* prefix_data = perm->mode_data;
+	prefix_data->next = position;
+	return 0;
+}
+
 int perm_prefix_destroy(struct cperm_t* perm) {
 	struct prefix_data_t* prefix_data = perm->mode_data;
 	free(prefix_data->vector);
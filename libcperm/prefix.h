@@ -39,6 +39,8 @@ struct prefix_data_t {
 int perm_prefix_create(struct cperm_t* perm);
 int perm_prefix_get(struct cperm_t* perm, uint64_t pt, uint64_t* ct);
 int perm_prefix_next(struct cperm_t* perm, uint64_t* ct);
+int perm_prefix_next_batch(struct cperm_t* perm, uint64_t* ct, int n);
+int perm_prefix_seek(struct cperm_t* perm, uint64_t position);
 int perm_prefix_destroy(struct cperm_t* perm);
 
 #endif /* PREFIX_H */
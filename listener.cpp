@@ -25,6 +25,9 @@ listener(void *args) {
     struct ip *ip = NULL;
     struct icmp *ippayload = NULL;
     int rcvsock; /* receive (icmp) socket file descriptor */
+    struct iovec iov;
+    struct msghdr msg;
+    char control[CMSG_SPACE(sizeof(uint32_t))];
 
     /* block until main thread says we're ready. */
     trace->lock(); 
@@ -33,6 +36,11 @@ listener(void *args) {
     if ((rcvsock = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP)) < 0) {
         cerr << "yarrp listener socket error:" << strerror(errno) << endl;
     }
+#ifdef SO_RXQ_OVFL
+    /* have the kernel report replies dropped for lack of buffer space */
+    int on = 1;
+    setsockopt(rcvsock, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on));
+#endif
 
     while (true) {
         if (nullreads >= MAXNULLREADS)
@@ -52,11 +60,25 @@ listener(void *args) {
         if (n > 0) {
             nullreads = 0;
             memset(buf, 0, PKTSIZE);
-            len = recv(rcvsock, buf, PKTSIZE, 0);
+            iov.iov_base = buf;
+            iov.iov_len = PKTSIZE;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            len = recvmsg(rcvsock, &msg, 0);
             if (len == -1) {
                 cerr << ">> Listener: read error: " << strerror(errno) << endl;
                 continue;
             }
+#ifdef SO_RXQ_OVFL
+            /* running count of drops on this socket */
+            for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+                if (c->cmsg_level == SOL_SOCKET and c->cmsg_type == SO_RXQ_OVFL)
+                    __atomic_store_n(&trace->stats->drops, *(uint32_t *) CMSG_DATA(c), __ATOMIC_RELAXED);
+            }
+#endif
             ip = (struct ip *)buf;
             if ((ip->ip_v == IPVERSION) and (ip->ip_p == IPPROTO_ICMP)) {
                 ippayload = (struct icmp *)&buf[ip->ip_hl << 2];
@@ -73,6 +95,8 @@ listener(void *args) {
                 }
                 if (icmp->getSport() == 0)
                     trace->stats->baddst+=1;
+                else
+                    __atomic_add_fetch(&trace->stats->replies, 1, __ATOMIC_RELAXED);
                 /* Fill mode logic. */
                 if (trace->config->fillmode) {
                     if ( (icmp->getTTL() >= trace->config->maxttl) and
@@ -84,16 +108,27 @@ listener(void *args) {
                         }
                     }
                 }
+                /* Tag replies with the retry pass their probe was sent in */
+                if (trace->retry)
+                    icmp->setAttempt(trace->retry->attempt(elapsed >= icmp->getRTT() ? elapsed - icmp->getRTT() : 0));
                 icmp->write(&(trace->config->out), trace->stats->count);
-#if 0
-                Status *status = NULL;
-                if (trace->tree != NULL) 
-                    status = (Status *) trace->tree->get(icmp->quoteDst());
-                if (status) {
-                    status->result(icmp->quoteTTL(), elapsed);
-                    //status->print();
+                /* Retry passes need not re-send a probe that drew a reply */
+                if (trace->retry and icmp->getSport() != 0 and
+                    (icmp->getType() == ICMP_TIMXCEED or icmp->getType() == ICMP_UNREACH))
+                    trace->retry->answered(icmp->getTarget(), icmp->getTTL());
+                /* Routers extend the prefix's horizon; targets don't */
+                if (trace->status and icmp->getType() == ICMP_TIMXCEED) {
+                    int *asn = (int *) trace->tree->get(icmp->quoteDst());
+                    if (asn)
+                        trace->status->result(trace->tree->prefix(asn), icmp->quoteTTL());
                 }
-#endif
+                /* Unreachables end the path; higher TTLs get no further */
+                if (trace->reached and icmp->getType() == ICMP_UNREACH and
+                    icmp->getSport() != 0)
+                    trace->reached->add(icmp->getTarget(), icmp->getTTL());
+                if (trace->stopset and icmp->getType() == ICMP_TIMXCEED and
+                    icmp->getSport() != 0)
+                    trace->stopset->result(icmp->getSrc(), icmp->quoteDst(), icmp->getTTL(), trace->stats);
                 /* TTL tree histogram */
                 if (trace->ttlhisto.size() > icmp->quoteTTL()) {
                     /* make certain we received a valid reply before adding  */
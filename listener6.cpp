@@ -39,6 +39,20 @@ int bpfinit(char *dev, size_t *bpflen) {
 }
 #endif
 
+/* Add the frames the kernel dropped on the capture socket to *drops */
+static void pollDrops(int sock, uint64_t *drops) {
+#ifdef _LINUX
+    struct tpacket_stats st;  /* counts since the previous call */
+    socklen_t len = sizeof(st);
+    if (getsockopt(sock, SOL_PACKET, PACKET_STATISTICS, &st, &len) == 0)
+        __atomic_add_fetch(drops, st.tp_drops, __ATOMIC_RELAXED);
+#else
+    struct bpf_stat st;       /* running counts */
+    if (ioctl(sock, BIOCGSTATS, &st) == 0)
+        __atomic_store_n(drops, st.bs_drop, __ATOMIC_RELAXED);
+#endif
+}
+
 void *listener6(void *args) {
     fd_set rfds;
     Traceroute6 *trace = reinterpret_cast < Traceroute6 * >(args);
@@ -51,6 +65,7 @@ void *listener6(void *args) {
     struct ip6_hdr *ip = NULL;                /* IPv6 hdr */
     struct icmp6_hdr *ippayload = NULL;       /* ICMP6 hdr */
     int rcvsock;                              /* receive (icmp) socket file descriptor */
+    time_t polled = 0;                        /* last check of kernel drops */
 
     /* block until main thread says we're ready. */
     trace->lock(); 
@@ -114,6 +129,10 @@ reloop:
         if (len == -1) {
             fatal("%s %s", __func__, strerror(errno));
         }
+        if (time(NULL) != polled) {
+            polled = time(NULL);
+            pollDrops(rcvsock, &trace->stats->drops);
+        }
         ip = (struct ip6_hdr *)(buf + ETH_HDRLEN);
         if (ip->ip6_nxt == IPPROTO_ICMPV6) {
             ippayload = (struct icmp6_hdr *)&buf[ETH_HDRLEN + sizeof(struct ip6_hdr)];
@@ -131,6 +150,7 @@ reloop:
                         delete icmp;
                         continue;
                     }
+                    __atomic_add_fetch(&trace->stats->replies, 1, __ATOMIC_RELAXED);
                     /* Fill mode logic. */
                     if (trace->config->fillmode) {
                         if ( (icmp->getTTL() >= trace->config->maxttl) and
@@ -139,7 +159,24 @@ reloop:
                          trace->probe(icmp->quoteDst6(), icmp->getTTL() + 1); 
                         }
                     }
+                    /* Tag replies with the retry pass their probe was sent in */
+                    if (trace->retry)
+                        icmp->setAttempt(trace->retry->attempt(elapsed >= icmp->getRTT() ? elapsed - icmp->getRTT() : 0));
                     icmp->write(&(trace->config->out), trace->stats->count);
+                    /* Retry passes need not re-send a probe that drew a reply */
+                    if (trace->retry)
+                        trace->retry->answered(icmp->getTarget6(), icmp->getTTL());
+                    /* Routers extend the prefix's horizon; targets don't */
+                    if (trace->status and icmp->getType() == ICMP6_TIME_EXCEEDED) {
+                        int *asn = (int *) trace->tree->get(icmp->quoteDst6());
+                        if (asn)
+                            trace->status->result(trace->tree->prefix(asn), icmp->quoteTTL());
+                    }
+                    /* The target answered, or its path ended */
+                    if (trace->reached and icmp->getType() != ICMP6_TIME_EXCEEDED)
+                        trace->reached->add(icmp->getTarget6(), icmp->getTTL());
+                    if (trace->stopset and icmp->getType() == ICMP6_TIME_EXCEEDED)
+                        trace->stopset->result(icmp->getSrc6(), icmp->getTarget6(), icmp->getTTL(), trace->stats);
                     /* TTL tree histogram */
                     if (trace->ttlhisto.size() > icmp->quoteTTL()) {
                      ttlhisto = trace->ttlhisto[icmp->quoteTTL()];
@@ -0,0 +1,120 @@
+/****************************************************************************
+   Program:     $Id: $
+   Date:        $Date: $
+   Description: benchmark compiled lookups against the Patricia trie
+                build: make lpmbench
+                usage: lpmbench [-4|-6] bgp_table [lookups]
+****************************************************************************/
+#include "yarrp.h"
+int verbosity = LOW;
+
+/* Random address: half within a routed prefix, half anywhere in 2000::/3
+   (IPv6) or the whole space (IPv4) */
+static void draw(vector<route_t> &routes, bool v6, struct in6_addr *a6, uint32_t *a4) {
+    uint64_t hi = ((uint64_t) random() << 33) ^ ((uint64_t) random() << 2) ^ random();
+    uint64_t lo = ((uint64_t) random() << 33) ^ ((uint64_t) random() << 2) ^ random();
+    if (random() & 1) {
+        route_t &r = routes[random() % routes.size()];
+        if (v6) {
+            uint64_t m = (r.bitlen >= 64) ? ~0ULL : (r.bitlen == 0) ? 0 : ~0ULL << (64 - r.bitlen);
+            hi = (r.addr & m) | (hi & ~m);
+            if (r.bitlen > 64)
+                lo = (r.addr_lo & (~0ULL << (128 - r.bitlen))) | (lo & ~(~0ULL << (128 - r.bitlen)));
+        } else {
+            uint32_t m = (r.bitlen == 0) ? 0 : 0xFFFFFFFF << (32 - r.bitlen);
+            hi = (r.addr & m) | (hi & ~m & 0xFFFFFFFF);
+        }
+    } else if (v6) {
+        hi = (hi >> 3) | (1ULL << 61);
+    }
+    if (v6) {
+        a6->s6_addr32[0] = htonl(hi >> 32);
+        a6->s6_addr32[1] = htonl(hi);
+        a6->s6_addr32[2] = htonl(lo >> 32);
+        a6->s6_addr32[3] = htonl(lo);
+    } else {
+        *a4 = htonl(hi);
+    }
+}
+
+static double timed(Patricia *tree, vector<struct in6_addr> &a6, vector<uint32_t> &a4, bool v6, long *found) {
+    double start = now();
+    long hits = 0;
+    for (size_t i = 0; i < a6.size(); i++) {
+        if (v6 ? tree->get(a6[i]) : tree->get(a4[i]))
+            hits++;
+    }
+    *found = hits;
+    return (now() - start) * 1e9 / a6.size();
+}
+
+static double batched(Patricia *tree, vector<struct in6_addr> &a6, vector<uint32_t> &a4, bool v6, long *found) {
+    int *out[DIR24_BATCH];
+    double start = now();
+    long hits = 0;
+    for (size_t i = 0; i < a6.size(); i += DIR24_BATCH) {
+        size_t m = min(a6.size() - i, (size_t) DIR24_BATCH);
+        if (v6)
+            tree->get(&a6[i], m, out);
+        else
+            tree->get(&a4[i], m, out);
+        for (size_t j = 0; j < m; j++)
+            if (out[j])
+                hits++;
+    }
+    *found = hits;
+    return (now() - start) * 1e9 / a6.size();
+}
+
+int
+main(int argc, char **argv) {
+    bool v6 = true;
+    int arg = 1;
+    if (argc > 1 and argv[1][0] == '-') {
+        v6 = (strcmp(argv[1], "-4") != 0);
+        arg++;
+    }
+    if (arg >= argc)
+        fatal("usage: %s [-4|-6] bgp_table [lookups]", argv[0]);
+    long n = (arg + 1 < argc) ? atol(argv[arg + 1]) : 10000000;
+    int family = v6 ? AF_INET6 : AF_INET;
+
+    Patricia trie(v6 ? 128 : 32), flat(v6 ? 128 : 32);
+    double t = now();
+    trie.populate(family, argv[arg]);
+    cout << ">> Loaded trie in " << now() - t << "s" << endl;
+    flat.populate(family, argv[arg]);
+    t = now();
+    flat.compile();
+    cout << ">> Compiled in " << now() - t << "s" << endl;
+
+    vector<route_t> routes;
+    trie.routes(routes);
+    vector<struct in6_addr> a6(n);
+    vector<uint32_t> a4(n);
+    srandom(1);
+    for (long i = 0; i < n; i++)
+        draw(routes, v6, &a6[i], &a4[i]);
+
+    long mismatch = 0;
+    vector<int *> batch(n);
+    if (v6)
+        flat.get(&a6[0], n, &batch[0]);
+    else
+        flat.get(&a4[0], n, &batch[0]);
+    for (long i = 0; i < n; i++) {
+        int *x = (int *) (v6 ? trie.get(a6[i]) : trie.get(a4[i]));
+        int *y = (int *) (v6 ? flat.get(a6[i]) : flat.get(a4[i]));
+        if ((x == NULL) != (y == NULL) or (x and *x != *y) or batch[i] != y)
+            mismatch++;
+    }
+    long hits;
+    double tp = timed(&trie, a6, a4, v6, &hits);
+    cout << "Patricia: " << tp << " ns/lookup (" << hits << " routed)" << endl;
+    double tf = timed(&flat, a6, a4, v6, &hits);
+    cout << "Compiled: " << tf << " ns/lookup (" << hits << " routed)" << endl;
+    double tb = batched(&flat, a6, a4, v6, &hits);
+    cout << "Batched: " << tb << " ns/lookup (" << hits << " routed)" << endl;
+    cout << "Speedup: " << tp / tf << "x (batched " << tp / tb << "x), mismatches: " << mismatch << "/" << n << endl;
+    return mismatch ? 1 : 0;
+}
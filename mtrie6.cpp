@@ -0,0 +1,225 @@
+/****************************************************************************
+   Program:     $Id: $
+   Date:        $Date: $
+   Description: compressed multibit trie for IPv6 longest-prefix match
+****************************************************************************/
+#include "yarrp.h"
+#include "snapshot.h"
+
+#define ROOT_SIZE (1 << 16)
+
+Mtrie6::Mtrie6() : root(NULL), nodes(NULL), leaves(NULL), values(NULL),
+                   nnodes(0), nleaves(0), nvalues(0) {
+}
+
+/* Byte i of a route's address */
+static inline uint8_t route_byte(const route_t &r, int i) {
+    return (i < 8) ? r.addr >> (56 - 8 * i) : r.addr_lo >> (56 - 8 * (i - 8));
+}
+
+static bool addr_order(const route_t &a, const route_t &b) {
+    if (a.addr != b.addr)
+        return a.addr < b.addr;
+    if (a.addr_lo != b.addr_lo)
+        return a.addr_lo < b.addr_lo;
+    return a.bitlen < b.bitlen;
+}
+
+static bool shorter(const route_t &a, const route_t &b) {
+    return a.bitlen < b.bitlen;
+}
+
+/* Fill node idx, covering address byte depth, from the routes [lo, hi) that
+   extend into it; inherit is the code of the longest shorter match.  Route
+   values have already been replaced by their codes. */
+void
+Mtrie6::node(uint32_t idx, std::vector<route_t> &routes, size_t lo, size_t hi,
+             int depth, uint32_t inherit) {
+    uint32_t val[256];
+    std::vector<route_t> here;
+    std::vector<size_t> firsts;
+    uint32_t end = 8 * (depth + 1), span, first, b;
+    size_t i, j, c;
+
+    /* prefixes ending in this node, painted shortest first */
+    for (i = 0; i < 256; i++)
+        val[i] = inherit;
+    for (i = lo; i < hi; i++) {
+        if (routes[i].bitlen <= end)
+            here.push_back(routes[i]);
+        else if (firsts.empty() or route_byte(routes[i], depth) != route_byte(routes[firsts.back()], depth))
+            firsts.push_back(i);
+    }
+    std::stable_sort(here.begin(), here.end(), shorter);
+    for (i = 0; i < here.size(); i++) {
+        span = 1 << (end - here[i].bitlen);
+        first = route_byte(here[i], depth) & ~(span - 1);
+        for (b = first; b < first + span; b++)
+            val[b] = here[i].value;
+    }
+    /* leaf runs */
+    mnode6_t n;
+    memset(&n, 0, sizeof(n));
+    n.lbase = leavesv.size();
+    for (b = 0; b < 256; b++) {
+        if (b == 0 or val[b] != val[b - 1]) {
+            n.leaf[b >> 6] |= 1ULL << (b & 63);
+            leavesv.push_back(val[b]);
+        }
+    }
+    /* children are contiguous, in byte order; longer prefixes sort after
+       shorter ones with the same address, so each child's routes follow */
+    n.cbase = nodesv.size();
+    for (c = 0; c < firsts.size(); c++) {
+        b = route_byte(routes[firsts[c]], depth);
+        n.child[b >> 6] |= 1ULL << (b & 63);
+    }
+    nodesv.resize(nodesv.size() + firsts.size());
+    nodesv[idx] = n;
+    for (c = 0; c < firsts.size(); c++) {
+        b = route_byte(routes[firsts[c]], depth);
+        for (j = firsts[c]; j < hi and route_byte(routes[j], depth) == b; j++);
+        node(n.cbase + c, routes, firsts[c], j, depth + 1, val[b]);
+    }
+}
+
+void
+Mtrie6::build(Patricia *tree) {
+    std::vector<route_t> routes, shorts;
+    uint32_t span, first, top;
+    size_t i, j;
+
+    rootv.assign(ROOT_SIZE, 0);
+    valuesv.push_back(0);  /* code 0: no route */
+    tree->routes(routes);
+    /* clear host bits, so a prefix sorts ahead of the routes it covers */
+    for (i = 0; i < routes.size(); i++) {
+        uint16_t len = routes[i].bitlen;
+        if (len < 64) {
+            routes[i].addr &= (len == 0) ? 0 : ~0ULL << (64 - len);
+            routes[i].addr_lo = 0;
+        } else if (len < 128) {
+            routes[i].addr_lo &= (len == 64) ? 0 : ~0ULL << (128 - len);
+        }
+    }
+    std::sort(routes.begin(), routes.end(), addr_order);
+    /* each prefix gets its own code, in address order */
+    valuesv.reserve(routes.size() + 1);
+    for (i = 0; i < routes.size(); i++) {
+        valuesv.push_back(routes[i].value);
+        routes[i].value = i + 1;
+    }
+    /* root: prefixes up to /16, shortest first */
+    for (i = 0; i < routes.size(); i++) {
+        if (routes[i].bitlen <= 16)
+            shorts.push_back(routes[i]);
+    }
+    std::stable_sort(shorts.begin(), shorts.end(), shorter);
+    for (i = 0; i < shorts.size(); i++) {
+        span = 1 << (16 - shorts[i].bitlen);
+        first = (shorts[i].addr >> 48) & ~(span - 1);
+        for (top = first; top < first + span; top++)
+            rootv[top] = shorts[i].value;
+    }
+    /* longer prefixes hang a node off their /16 */
+    for (i = 0; i < routes.size(); i = j) {
+        top = routes[i].addr >> 48;
+        for (j = i; j < routes.size() and (routes[j].addr >> 48) == top; j++);
+        size_t k = i;
+        while (k < j and routes[k].bitlen <= 16)
+            k++;
+        if (k == j)
+            continue;
+        nodesv.resize(nodesv.size() + 1);
+        uint32_t idx = nodesv.size() - 1;
+        node(idx, routes, k, j, 2, rootv[top]);
+        rootv[top] = MTRIE6_EXT | idx;
+    }
+    root = rootv.data();
+    nodes = nodesv.data();
+    nnodes = nodesv.size();
+    leaves = leavesv.data();
+    nleaves = leavesv.size();
+    values = valuesv.data();
+    nvalues = valuesv.size();
+    debug(LOW, ">> Compiled " << routes.size() << " IPv6 prefixes into multibit trie ("
+          << nnodes << " nodes, " << bytes() / 1024 << " KB)");
+}
+
+/*
+ * Each round advances every unresolved address one stride, prefetching the
+ * node (or leaf) it needs next, so the misses of a batch overlap.
+ */
+void
+Mtrie6::get(const struct in6_addr *addrs, size_t n, int **out) {
+    uint32_t e[MTRIE6_BATCH], leaf[MTRIE6_BATCH];
+    uint8_t live[MTRIE6_BATCH];
+    size_t nlive;
+
+    for (size_t base = 0; base < n; base += MTRIE6_BATCH) {
+        size_t m = std::min(n - base, (size_t) MTRIE6_BATCH);
+        const struct in6_addr *addr = addrs + base;
+        for (size_t i = 0; i < m; i++)
+            __builtin_prefetch(&root[(addr[i].s6_addr[0] << 8) | addr[i].s6_addr[1]]);
+        nlive = 0;
+        for (size_t i = 0; i < m; i++) {
+            e[i] = root[(addr[i].s6_addr[0] << 8) | addr[i].s6_addr[1]];
+            leaf[i] = UINT32_MAX;
+            if (e[i] & MTRIE6_EXT) {
+                __builtin_prefetch(&nodes[e[i] & ~MTRIE6_EXT]);
+                live[nlive++] = i;
+            }
+        }
+        for (int d = 2; nlive > 0; d++) {
+            size_t k = 0;
+            for (size_t j = 0; j < nlive; j++) {
+                uint8_t i = live[j];
+                uint8_t b = addr[i].s6_addr[d];
+                mnode6_t *nd = &nodes[e[i] & ~MTRIE6_EXT];
+                if (nd->child[b >> 6] & (1ULL << (b & 63))) {
+                    e[i] = MTRIE6_EXT | (nd->cbase + rank(nd->child, b));
+                    __builtin_prefetch(&nodes[e[i] & ~MTRIE6_EXT]);
+                    live[k++] = i;
+                } else {
+                    leaf[i] = nd->lbase + rank(nd->leaf, b + 1) - 1;
+                    __builtin_prefetch(&leaves[leaf[i]]);
+                }
+            }
+            nlive = k;
+        }
+        for (size_t i = 0; i < m; i++) {
+            if (leaf[i] != UINT32_MAX)
+                e[i] = leaves[leaf[i]];
+            out[base + i] = e[i] ? &values[e[i]] : NULL;
+        }
+    }
+}
+
+size_t
+Mtrie6::bytes() {
+    return ROOT_SIZE * sizeof(uint32_t) + nnodes * sizeof(mnode6_t) +
+           nleaves * sizeof(uint32_t) + nvalues * sizeof(int);
+}
+
+bool
+Mtrie6::save(FILE *f, uint64_t *count) {
+    count[0] = nnodes;
+    count[1] = nleaves;
+    count[2] = nvalues;
+    return snap_write(f, root, ROOT_SIZE * sizeof(uint32_t)) and
+           snap_write(f, nodes, nnodes * sizeof(mnode6_t)) and
+           snap_write(f, leaves, nleaves * sizeof(uint32_t)) and
+           snap_write(f, values, nvalues * sizeof(int));
+}
+
+bool
+Mtrie6::attach(const char **p, const char *end, const uint64_t *count) {
+    nnodes = count[0];
+    nleaves = count[1];
+    nvalues = count[2];
+    root = (uint32_t *) snap_map(p, end, ROOT_SIZE * sizeof(uint32_t));
+    nodes = (mnode6_t *) snap_map(p, end, nnodes * sizeof(mnode6_t));
+    leaves = (uint32_t *) snap_map(p, end, nleaves * sizeof(uint32_t));
+    values = (int *) snap_map(p, end, nvalues * sizeof(int));
+    return root and nodes and leaves and values;
+}
@@ -0,0 +1,98 @@
+/****************************************************************************
+   Program:     $Id: $
+   Date:        $Date: $
+   Description: compressed multibit trie for IPv6 longest-prefix match
+****************************************************************************/
+
+#ifndef MTRIE6_H
+#define MTRIE6_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <netinet/in.h>
+#include <vector>
+
+class Patricia;
+struct _route_t;
+
+/* root entry: index into values, or (with MTRIE6_EXT) a node */
+#define MTRIE6_EXT 0x80000000
+/* addresses resolved together by the batched get() */
+#define MTRIE6_BATCH 64
+
+/* 8-bit stride node: a bit per child, and a bit where each run of leaves starts */
+typedef struct _mnode6_t {
+    uint64_t child[4];
+    uint64_t leaf[4];
+    uint32_t cbase;   /* first of this node's children in nodes */
+    uint32_t lbase;   /* first of this node's leaf runs in leaves */
+} mnode6_t;
+
+/*
+ * Read-only copy of an IPv6 Patricia trie.  A 2^16 entry root covers the
+ * first 16 bits, then 8-bit stride nodes; BGP prefixes up to /48 resolve in
+ * at most five reads.  Prefixes are pushed to the leaves, and each node
+ * stores only its children and the distinct runs of leaf values, indexed by
+ * popcount (as in poptrie), so a full IPv6 RIB takes a few MB.  Leaves are
+ * codes of the matching prefix, indexing a table of its trie value; code 0
+ * means no route.
+ */
+class Mtrie6 {
+  public:
+  Mtrie6();
+  void build(Patricia *tree);
+  /* snapshot sections; attach() points into a mapped snapshot */
+  bool save(FILE *f, uint64_t *count);
+  bool attach(const char **p, const char *end, const uint64_t *count);
+  /* Trie value of the longest matching prefix, or NULL */
+  inline int *get(const struct in6_addr *addr) {
+    const uint8_t *a = addr->s6_addr;
+    uint32_t e = root[(a[0] << 8) | a[1]];
+    for (int i = 2; e & MTRIE6_EXT; i++) {
+      mnode6_t *n = &nodes[e & ~MTRIE6_EXT];
+      if (n->child[a[i] >> 6] & (1ULL << (a[i] & 63))) {
+        e = MTRIE6_EXT | (n->cbase + rank(n->child, a[i]));
+      } else {
+        e = leaves[n->lbase + rank(n->leaf, a[i] + 1) - 1];
+        break;
+      }
+    }
+    return e ? &values[e] : NULL;
+  }
+  /* get() of n addresses, walked a level at a time with prefetches */
+  void get(const struct in6_addr *addrs, size_t n, int **out);
+  uint32_t size() { return nnodes; }
+  size_t bytes();
+  /* code of the prefix whose value get() returned, and one past the last */
+  uint32_t code(const int *value) { return value - values; }
+  uint32_t codes() { return nvalues; }
+  /* trie value of a code */
+  int value(uint32_t code) { return values[code]; }
+
+  private:
+  /* set bits below position b */
+  static inline uint32_t rank(const uint64_t *bits, uint32_t b) {
+    uint32_t r = 0;
+    for (uint32_t w = 0; w < (b >> 6); w++)
+      r += __builtin_popcountll(bits[w]);
+    if (b & 63)
+      r += __builtin_popcountll(bits[b >> 6] & ((1ULL << (b & 63)) - 1));
+    return r;
+  }
+  void node(uint32_t idx, std::vector<struct _route_t> &routes, size_t lo, size_t hi,
+            int depth, uint32_t inherit);
+  uint32_t *root;
+  mnode6_t *nodes;
+  uint32_t *leaves;
+  int *values;
+  uint64_t nnodes;
+  uint64_t nleaves;
+  uint64_t nvalues;
+  /* storage, when built here */
+  std::vector<uint32_t> rootv;
+  std::vector<mnode6_t> nodesv;
+  std::vector<uint32_t> leavesv;
+  std::vector<int> valuesv;
+};
+
+#endif /* MTRIE6_H */
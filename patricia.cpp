@@ -17,8 +17,13 @@
 #include <netinet/in.h> /* BSD, Linux: for inet_addr */
 #include <arpa/inet.h> /* BSD, Linux, Solaris: for inet_addr */
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include "patricia.h"
-#include "status.h"
+#include "snapshot.h"
 #include <algorithm>
 
 #ifdef TESTING
@@ -318,6 +323,64 @@ Deref_Prefix (prefix_t * prefix)
 
 static int num_active_patricia = 0;
 
+/*
+ * Nodes are carved from per-tree chunks rather than malloc'd one at a
+ * time: a full BGP table is ~1M nodes, and packing them keeps a lookup's
+ * path within fewer cache lines.  Each node carries its own prefix and
+ * room for an int of user data, so an insertion costs no other allocation.
+ */
+#define PATRICIA_ARENA_NODES 4096
+
+typedef struct _patricia_arena_t {
+    struct _patricia_arena_t *next;
+    patricia_node_t node[PATRICIA_ARENA_NODES];
+} patricia_arena_t;
+
+static patricia_node_t *
+New_Node (patricia_tree_t *patricia)
+{
+    patricia_node_t *node = patricia->free_node;
+
+    if (node) {
+	patricia->free_node = node->parent;
+    }
+    else {
+	if (patricia->arena == NULL || patricia->arena_used == PATRICIA_ARENA_NODES) {
+	    patricia_arena_t *arena = (patricia_arena_t *) malloc(sizeof *arena);
+	    assert (arena);
+	    arena->next = patricia->arena;
+	    patricia->arena = arena;
+	    patricia->arena_used = 0;
+	}
+	node = &patricia->arena->node[patricia->arena_used++];
+    }
+    memset (node, 0, sizeof *node);
+    return (node);
+}
+
+static void
+Free_Node (patricia_tree_t *patricia, patricia_node_t *node)
+{
+    node->parent = patricia->free_node;
+    patricia->free_node = node;
+}
+
+/* copy prefix into the node; the tree never takes a reference to it */
+static prefix_t *
+Node_Prefix (patricia_node_t *node, prefix_t *prefix)
+{
+    node->pfx.family = prefix->family;
+    node->pfx.bitlen = prefix->bitlen;
+    node->pfx.ref_count = 1;
+#ifdef HAVE_IPV6
+    if (prefix->family == AF_INET6)
+	memcpy (&node->pfx.add.sin6, &prefix->add.sin6, sizeof(struct in6_addr));
+    else
+#endif /* HAVE_IPV6 */
+	memcpy (&node->pfx.add.sin, &prefix->add.sin, sizeof(struct in_addr));
+    return (&node->pfx);
+}
+
 /* these routines support continuous mask only */
 
 patricia_tree_t *
@@ -328,6 +391,8 @@ New_Patricia (int maxbits)
     patricia->maxbits = maxbits;
     patricia->head = NULL;
     patricia->num_active_node = 0;
+    patricia->arena = NULL;
+    patricia->free_node = NULL;
     assert (maxbits <= PATRICIA_MAXBITS); /* XXX */
     num_active_patricia++;
     return (patricia);
@@ -353,15 +418,11 @@ Clear_Patricia (patricia_tree_t *patricia)
             patricia_node_t *l = Xrn->l;
             patricia_node_t *r = Xrn->r;
 
-    	    if (Xrn->prefix) {
-		Deref_Prefix (Xrn->prefix);
-    	    }
-    	    else {
+    	    if (Xrn->prefix == NULL) {
 		assert (Xrn->data == NULL);
     	    }
-	    if (Xrn->user1)
+	    if (Xrn->user1 && Xrn->user1 != &Xrn->value)
 		free(Xrn->user1);
-    	    free (Xrn);
 	    patricia->num_active_node--;
 
             if (l) {
@@ -380,6 +441,14 @@ Clear_Patricia (patricia_tree_t *patricia)
         }
     }
     assert (patricia->num_active_node == 0);
+    /* nodes go back in bulk */
+    while (patricia->arena) {
+	patricia_arena_t *next = patricia->arena->next;
+	free (patricia->arena);
+	patricia->arena = next;
+    }
+    patricia->head = NULL;
+    patricia->free_node = NULL;
     /* free (patricia); */
 }
 
@@ -623,9 +692,9 @@ patricia_lookup (patricia_tree_t *patricia, prefix_t *prefix)
     assert (prefix->bitlen <= patricia->maxbits);
 
     if (patricia->head == NULL) {
-	node = (patricia_node_t *) calloc(1, sizeof *node);
+	node = New_Node (patricia);
 	node->bit = prefix->bitlen;
-	node->prefix = Ref_Prefix (prefix);
+	node->prefix = Node_Prefix (node, prefix);
 	node->parent = NULL;
 	node->l = node->r = NULL;
 	node->data = NULL;
@@ -725,7 +794,7 @@ patricia_lookup (patricia_tree_t *patricia, prefix_t *prefix)
 #endif /* PATRICIA_DEBUG */
 	    return (node);
 	}
-	node->prefix = Ref_Prefix (prefix);
+	node->prefix = Node_Prefix (node, prefix);
 #ifdef PATRICIA_DEBUG
 	fprintf (stderr, "patricia_lookup: new node #1 %s/%d (glue mod)\n",
 		 prefix_toa (prefix), prefix->bitlen);
@@ -734,9 +803,9 @@ patricia_lookup (patricia_tree_t *patricia, prefix_t *prefix)
 	return (node);
     }
 
-    new_node = (patricia_node_t *) calloc(1, sizeof *new_node);
+    new_node = New_Node (patricia);
     new_node->bit = prefix->bitlen;
-    new_node->prefix = Ref_Prefix (prefix);
+    new_node->prefix = Node_Prefix (new_node, prefix);
     new_node->parent = NULL;
     new_node->l = new_node->r = NULL;
     new_node->data = NULL;
@@ -786,7 +855,7 @@ patricia_lookup (patricia_tree_t *patricia, prefix_t *prefix)
 #endif /* PATRICIA_DEBUG */
     }
     else {
-        glue = (patricia_node_t *) calloc(1, sizeof *glue);
+        glue = New_Node (patricia);
         glue->bit = differ_bit;
         glue->prefix = NULL;
         glue->parent = node->parent;
@@ -840,8 +909,6 @@ patricia_remove (patricia_tree_t *patricia, patricia_node_t *node)
 	
 	/* this might be a placeholder node -- have to check and make sure
 	 * there is a prefix aossciated with it ! */
-	if (node->prefix != NULL) 
-	  Deref_Prefix (node->prefix);
 	node->prefix = NULL;
 	/* Also I needed to clear data pointer -- masaki */
 	node->data = NULL;
@@ -854,8 +921,7 @@ patricia_remove (patricia_tree_t *patricia, patricia_node_t *node)
 		 prefix_toa (node->prefix), node->prefix->bitlen);
 #endif /* PATRICIA_DEBUG */
 	parent = node->parent;
-	Deref_Prefix (node->prefix);
-	free (node);
+	Free_Node (patricia, node);
         patricia->num_active_node--;
 
 	if (parent == NULL) {
@@ -891,7 +957,7 @@ patricia_remove (patricia_tree_t *patricia, patricia_node_t *node)
 	    parent->parent->l = child;
 	}
 	child->parent = parent->parent;
-	free (parent);
+	Free_Node (patricia, parent);
         patricia->num_active_node--;
 	return;
     }
@@ -910,8 +976,7 @@ patricia_remove (patricia_tree_t *patricia, patricia_node_t *node)
     parent = node->parent;
     child->parent = parent;
 
-    Deref_Prefix (node->prefix);
-    free (node);
+    Free_Node (patricia, node);
     patricia->num_active_node--;
 
     if (parent == NULL) {
@@ -970,16 +1035,19 @@ try_search_best (patricia_tree_t *tree, char *string)
     return (node);
 }
 
-void *Patricia::get(prefix_t *prefix, bool exact) {
-    void *retval = NULL;
+void *Patricia::find(prefix_t *prefix, bool exact) {
     patricia_node_t *node;
     if (exact)
         node = patricia_search_exact(tree, prefix);
     else
         node = patricia_search_best(tree, prefix);
-    if ( (node) and (node->user1) )
-        retval = node->user1;
+    if (node)
+        return node->user1;
+    return NULL;
+}
 
+void *Patricia::get(prefix_t *prefix, bool exact) {
+    void *retval = find(prefix, exact);
     Deref_Prefix (prefix);
     return retval;
 }
@@ -989,14 +1057,38 @@ void *Patricia::get(int family, const char *string, bool exact) {
     return get(prefix, exact);
 }
 
+/* per-address lookups use a prefix on the stack */
 void *Patricia::get(uint32_t addr, bool exact) {
-    prefix_t *prefix = int2prefix(addr);
-    return get(prefix, exact);
+    prefix_t prefix;
+    struct in_addr sin;
+    sin.s_addr = addr;
+    New_Prefix2(AF_INET, &sin, 32, &prefix);
+    return find(&prefix, exact);
+}
+
+void *Patricia::get6(struct in6_addr addr) {
+    prefix_t prefix;
+    New_Prefix2(AF_INET6, &addr, 128, &prefix);
+    return find(&prefix, false);
 }
 
-void *Patricia::get(struct in6_addr addr) {
-    prefix_t *prefix = New_Prefix(AF_INET6, &addr, 128);
-    return get(prefix, false);
+/* Compiled tables resolve a batch with overlapping misses; the trie can't */
+void Patricia::get(const uint32_t *addrs, size_t n, int **out) {
+    if (flat) {
+        flat->get(addrs, n, out);
+        return;
+    }
+    for (size_t i = 0; i < n; i++)
+        out[i] = (int *) get(addrs[i], false);
+}
+
+void Patricia::get(const struct in6_addr *addrs, size_t n, int **out) {
+    if (flat6) {
+        flat6->get(addrs, n, out);
+        return;
+    }
+    for (size_t i = 0; i < n; i++)
+        out[i] = (int *) get6(addrs[i]);
 }
 
 int Patricia::matchingPrefix(prefix_t *prefix) {
@@ -1025,63 +1117,43 @@ int Patricia::matchingPrefix(const char *string, int family) {
     return matchingPrefix(prefix);
 }
 
-int Patricia::parsePrefix(int family, char *_line, std::string *p) {
-    std::string line(_line);
-    // remove whitespace
-    line.erase(std::remove(line.begin(), line.end(), '\n'), line.end());
-    line.erase(std::remove(line.begin(), line.end(), ' '), line.end());
-    std::string::size_type slash = line.find_first_of("/");
-    int mask = 0;
-    std::istringstream(line.substr(slash+1, line.length())) >> mask;
-    std::string net = line.substr(0,slash);
-    struct in_addr dummy;
-    if (family == AF_INET6) {
-      struct in6_addr dummy;
-      if ((inet_pton(AF_INET6, net.c_str(), &dummy) != 1) or (mask < 0) or (mask > 128)) {
-        std::cerr << "Badly formed IPv6 block prefix: [" << line << "]" << std::endl;
-        exit(-1);
-      }
-    } else {
-      struct in_addr dummy;
-      if ((inet_pton(AF_INET, net.c_str(), &dummy) != 1) or (mask < 0) or (mask > 32)) {
-        std::cerr << "Badly formed IPv4 block prefix: [" << line << "]" << std::endl;
-        exit(-1);
-      }
-    }
-    *p = line;
-    return 1;
+/* All prefixes holding a value, in no particular order */
+void Patricia::routes(std::vector<route_t> &out) {
+    patricia_node_t *node;
+    route_t r;
+
+    PATRICIA_WALK(tree->head, node) {
+        if (node->user1) {
+            r.bitlen = node->prefix->bitlen;
+            r.value = *(int *) node->user1;
+            r.addr_lo = 0;
+            if (node->prefix->family == AF_INET6) {
+                r.addr = ((uint64_t) ntohl(node->prefix->add.sin6.s6_addr32[0]) << 32) |
+                         ntohl(node->prefix->add.sin6.s6_addr32[1]);
+                r.addr_lo = ((uint64_t) ntohl(node->prefix->add.sin6.s6_addr32[2]) << 32) |
+                            ntohl(node->prefix->add.sin6.s6_addr32[3]);
+            } else {
+                r.addr = ntohl(node->prefix->add.sin.s_addr);
+            }
+            out.push_back(r);
+        }
+    } PATRICIA_WALK_END;
 }
 
-int Patricia::parseBGPLine(char *_line, std::string *net, uint32_t *asn, int *family) {
-    std::string line(_line);
-    std::string::size_type first_space, last_space, first_non_white;
-    first_non_white = line.find_first_not_of(' ');
-    first_space = line.find(' ', first_non_white);
-    last_space = line.rfind(' ');
-    if (line.find('>') != std::string::npos) {
-        *net = line.substr(first_non_white+1,first_space-1);
+/* Answer longest-match lookups from a flattened copy of the trie */
+void Patricia::compile() {
+    unmap();
+    if (tree->maxbits == 32) {
+        if (flat)
+            delete flat;
+        flat = new Dir24();
+        flat->build(this);
     } else {
-        *net = line.substr(first_non_white,first_space-1);
+        if (flat6)
+            delete flat6;
+        flat6 = new Mtrie6();
+        flat6->build(this);
     }
-
-    /* infer the address family (v4/v6) of the entry */
-    std::string pre;
-    std::string::size_type slash;
-    slash = net->find('/');
-    pre = net->substr(0,slash);
-    struct in_addr dummy;
-    if (inet_aton(pre.c_str(), &dummy) == 1)
-        *family = AF_INET;
-    else
-        *family = AF_INET6;
-
-    /* grab origin ASN */
-    std::string asn_str = line.substr(last_space);
-    asn_str = asn_str.substr(0,asn_str.length()-1);
-    std::stringstream ss;
-    ss.str(asn_str);
-    ss >> *asn;
-    return 1;
 }
 
 void Patricia::populate(int family, const char *filename) {
@@ -1092,56 +1164,299 @@ void Patricia::populateBlock(int family, const char *filename) {
     populate(family, filename, true);
 }
 
+/* FNV-1a over the raw bytes of the input files */
+static uint64_t fnv1a(uint64_t h, const char *filename) {
+    char buf[1 << 16];
+    size_t n;
+    FILE *f = fopen(filename, "r");
+    if (f == NULL)
+        return h;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        for (size_t i = 0; i < n; i++)
+            h = (h ^ (uint8_t) buf[i]) * 0x100000001b3ULL;
+    }
+    fclose(f);
+    return h;
+}
+
+uint64_t Patricia::fingerprint(int family, const char *bgpfile, const char *blocklist) {
+    uint64_t h = 0xcbf29ce484222325ULL ^ family;
+    h = (h ^ 'b') * 0x100000001b3ULL;
+    if (bgpfile)
+        h = fnv1a(h, bgpfile);
+    h = (h ^ 'B') * 0x100000001b3ULL;
+    if (blocklist)
+        h = fnv1a(h, blocklist);
+    return h;
+}
+
+/* Write the compiled table, via a temporary file renamed into place */
+bool Patricia::save(const char *filename, uint64_t hash) {
+    snap_hdr_t hdr;
+    std::string tmp = std::string(filename) + ".tmp";
+    bool ok;
+
+    if (not flat and not flat6)
+        return false;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, SNAP_MAGIC, sizeof(hdr.magic));
+    hdr.family = flat ? AF_INET : AF_INET6;
+    hdr.hash = hash;
+    FILE *f = fopen(tmp.c_str(), "w");
+    if (f == NULL)
+        return false;
+    /* header first for its alignment padding; rewritten with the counts */
+    ok = snap_write(f, &hdr, sizeof(hdr));
+    ok = ok and (flat ? flat->save(f, hdr.count) : flat6->save(f, hdr.count));
+    ok = ok and fseek(f, 0, SEEK_SET) == 0 and fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+    ok = (fclose(f) == 0) and ok;
+    if (ok)
+        ok = rename(tmp.c_str(), filename) == 0;
+    if (not ok)
+        unlink(tmp.c_str());
+    return ok;
+}
+
+/* Map a snapshot written by save(); false if absent or for other inputs */
+bool Patricia::load(const char *filename, uint64_t hash) {
+    struct stat st;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return false;
+    if (fstat(fd, &st) < 0 or (size_t) st.st_size < sizeof(snap_hdr_t)) {
+        close(fd);
+        return false;
+    }
+    unmap();
+    snaplen = st.st_size;
+    snap = mmap(NULL, snaplen, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (snap == MAP_FAILED) {
+        snap = NULL;
+        return false;
+    }
+    const snap_hdr_t *hdr = (const snap_hdr_t *) snap;
+    int family = (tree->maxbits == 32) ? AF_INET : AF_INET6;
+    if (memcmp(hdr->magic, SNAP_MAGIC, sizeof(hdr->magic)) != 0 or
+        hdr->family != (uint32_t) family or hdr->hash != hash) {
+        unmap();
+        return false;
+    }
+    const char *p = (const char *) snap + snap_pad(sizeof(snap_hdr_t));
+    const char *end = (const char *) snap + snaplen;
+    bool ok;
+    if (family == AF_INET) {
+        flat = new Dir24();
+        ok = flat->attach(&p, end, hdr->count);
+    } else {
+        flat6 = new Mtrie6();
+        ok = flat6->attach(&p, end, hdr->count);
+    }
+    if (not ok)
+        unmap();
+    return ok;
+}
+
+void Patricia::unmap() {
+    if (snap == NULL)
+        return;
+    if (flat) {
+        delete flat;
+        flat = NULL;
+    }
+    if (flat6) {
+        delete flat6;
+        flat6 = NULL;
+    }
+    munmap(snap, snaplen);
+    snap = NULL;
+}
+
+/* Hand-written prefix parser: dotted quad (IPv4) or inet_pton (IPv6), then an
+   optional /len.  Fills a caller-owned prefix; returns false if malformed. */
+static bool parse_prefix(int family, const char *s, const char *end, prefix_t *prefix) {
+    const char *slash = (const char *) memchr(s, '/', end - s);
+    const char *stop = slash ? slash : end;
+    int maxbits = (family == AF_INET6) ? 128 : 32;
+    long bitlen = maxbits;
+
+    if (family == AF_INET) {
+        uint32_t addr = 0, octet;
+        for (int i = 0; i < 4; i++) {
+            if (s >= stop or not isdigit(*s))
+                return false;
+            for (octet = 0; s < stop and isdigit(*s) and octet <= 255; s++)
+                octet = octet * 10 + (*s - '0');
+            if (octet > 255 or (i < 3 and (s >= stop or *s++ != '.')))
+                return false;
+            addr = (addr << 8) | octet;
+        }
+        if (s != stop)
+            return false;
+        addr = htonl(addr);
+        New_Prefix2(AF_INET, &addr, maxbits, prefix);
+    } else {
+        char buf[INET6_ADDRSTRLEN];
+        struct in6_addr addr;
+        if (stop - s >= INET6_ADDRSTRLEN)
+            return false;
+        memcpy(buf, s, stop - s);
+        buf[stop - s] = '\0';
+        if (inet_pton(AF_INET6, buf, &addr) != 1)
+            return false;
+        New_Prefix2(AF_INET6, &addr, maxbits, prefix);
+    }
+    if (slash) {
+        for (bitlen = 0, s = slash + 1; s < end and isdigit(*s) and bitlen <= maxbits; s++)
+            bitlen = bitlen * 10 + (*s - '0');
+        if (s != end or s == slash + 1 or bitlen > maxbits)
+            return false;
+    }
+    prefix->bitlen = bitlen;
+    return true;
+}
+
+static inline bool space(char c) {
+    return c == ' ' or c == '\t' or c == '\r' or c == '\n';
+}
+
+/* BGP table line: [*>]prefix ... origin_asn [origin code] */
+static bool parse_bgp(int family, const char *s, const char *end, prefix_t *prefix, int *asn) {
+    const char *tok, *last = NULL;
+
+    while (s < end and (space(*s) or *s == '*' or *s == '>'))
+        s++;
+    for (tok = s; s < end and not space(*s); s++);
+    if (s == tok)
+        return false;
+    /* other address family */
+    if ((memchr(tok, ':', s - tok) != NULL) != (family == AF_INET6))
+        return false;
+    if (not parse_prefix(family, tok, s, prefix))
+        return false;
+    /* last numeric token is the origin AS */
+    for (const char *p = s; p < end; ) {
+        while (p < end and space(*p))
+            p++;
+        if (p < end and isdigit(*p))
+            last = p;
+        while (p < end and not space(*p))
+            p++;
+    }
+    if (last == NULL)
+        return false;
+    *asn = strtoul(last, NULL, 10);
+    return true;
+}
+
+/* Loaded entry, sorted so covering prefixes are inserted first */
+typedef struct _entry_t {
+    prefix_t prefix;
+    int value;
+} entry_t;
+
+static bool entry_order(const entry_t &a, const entry_t &b) {
+    int c = memcmp(&a.prefix.add, &b.prefix.add,
+                   a.prefix.family == AF_INET6 ? sizeof(struct in6_addr) : sizeof(struct in_addr));
+    if (c != 0)
+        return c < 0;
+    return a.prefix.bitlen < b.prefix.bitlen;
+}
+
+/* Decompressed bytes per gzread() */
+#define LOAD_CHUNK (1 << 20)
+
 /*  we have two types of entries in the table:
  *  0 => prefix is blacklisted
  *  ASN => prefix's AS number
+ *
+ *  The file is decompressed in large chunks and parsed in place; entries are
+ *  then sorted and inserted in bulk.
  */
 void Patricia::populate(int family, const char *filename, bool block) {
+    if (not read(family, filename, block))
+        exit(-1);
+}
+
+/* Nothing is inserted until the whole file has parsed */
+bool Patricia::read(int family, const char *filename, bool block) {
     gzFile f = gzopen(filename, "r");
-    assert(f);
-    char line[MAXLINE];
-    std::string network;
-    uint32_t asn;
-    int bgpfamily;
-    while (!gzeof(f)) {
-        if (gzgets(f, line, MAXLINE) == NULL) break;
-        if (block) {
-            if (parsePrefix(family, line, &network)) {
-                //std::cout << "Block Prefix: " << network << std::endl;
-                add(family, network.c_str(), 0); 
-            }
-        } else {
-            if (parseBGPLine(line, &network, &asn, &bgpfamily)) {
-                // IP address family in bgptable different than current mode (v4/v6)
-                if (bgpfamily != family)
-                  continue;
-                // lookup first, ensure prefix isn't contained in a blacklistd prefix
-                if ( matchingPrefix(network.c_str(), family) != 0 )
-                  add(family, network.c_str(), asn); 
+    if (f == NULL) {
+        std::cerr << "Cannot open " << filename << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    gzbuffer(f, LOAD_CHUNK / 4);
+    char *buf = (char *) malloc(LOAD_CHUNK + MAXLINE);
+    std::vector<entry_t> entries;
+    entry_t e;
+    size_t have = 0;
+    int n;
+    bool eof = false, ok = true;
+
+    while (ok and not eof) {
+        n = gzread(f, buf + have, LOAD_CHUNK);
+        if (n < 0) {
+            std::cerr << "Error reading " << filename << std::endl;
+            ok = false;
+            break;
+        }
+        have += n;
+        eof = (n == 0);
+        if (eof and have > 0 and buf[have - 1] != '\n')
+            buf[have++] = '\n';
+        char *line = buf, *nl, *end = buf + have;
+        while (ok and (nl = (char *) memchr(line, '\n', end - line)) != NULL) {
+            if (block) {
+                char *s = line, *t = (char *) memchr(line, '#', nl - line);
+                if (t == NULL)
+                    t = nl;
+                while (s < t and space(*s))
+                    s++;
+                while (t > s and space(t[-1]))
+                    t--;
+                if (s < t) {
+                    if (not parse_prefix(family, s, t, &e.prefix)) {
+                        std::cerr << "Badly formed block prefix: [" << std::string(s, t - s) << "]" << std::endl;
+                        ok = false;
+                    }
+                    e.value = 0;
+                    entries.push_back(e);
+                }
+            } else if (parse_bgp(family, line, nl, &e.prefix, &e.value)) {
+                entries.push_back(e);
             }
+            line = nl + 1;
         }
+        have = end - line;
+        if (have >= MAXLINE) {
+            std::cerr << "Line too long in " << filename << std::endl;
+            ok = false;
+        }
+        memmove(buf, line, have);
     }
+    free(buf);
     gzclose(f);
-}
-
-void Patricia::populateStatus(const char *filename) {
-    gzFile f = gzopen(filename, "r");
-    assert(f);
-    char line[MAXLINE];
-    std::string network;
-    uint32_t asn;
-    int bgpfamily;
-    /* Only need to create one status object; Patricia::add memcpy's */
-    //Status *status = new Status;
-    while (!gzeof(f)) {
-        if (gzgets(f, line, MAXLINE) == NULL) break;
-        if (parseBGPLine(line, &network, &asn, &bgpfamily)) {
-            Status *status = new Status;
-            add_ref(network.c_str(), status); 
-            //std::cout << "Prefix: " << network << "ASN: " << asn << std::endl;
+    if (not ok)
+        return false;
+
+    std::stable_sort(entries.begin(), entries.end(), entry_order);
+    for (size_t i = 0; i < entries.size(); i++) {
+        prefix_t *prefix = &entries[i].prefix;
+        patricia_node_t *node;
+        /* ensure a route isn't contained in a blocklisted prefix */
+        if (not block) {
+            node = patricia_search_best(tree, prefix);
+            if (node and node->user1 and *(int *) node->user1 == 0)
+                continue;
+        }
+        /* only set data if node didn't already exist */
+        node = patricia_lookup(tree, prefix);
+        if (node and node->user1 == NULL) {
+            node->value = entries[i].value;
+            node->user1 = &node->value;
         }
     }
-    gzclose(f);
+    return true;
 }
 
 #ifdef TESTING
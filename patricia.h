@@ -28,8 +28,12 @@ typedef void (*void_fn_t)();
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <vector>
 #include <zlib.h>
 
+#include "dir24.h"
+#include "mtrie6.h"
+
 typedef struct _prefix4_t {
     u_short family;		/* AF_INET | AF_INET6 */
     u_short bitlen;		/* same as mask? */
@@ -50,6 +54,14 @@ typedef struct _prefix_t {
 } prefix_t;
 
 
+/* A prefix in the trie and its value (origin ASN, or 0 if blocked) */
+typedef struct _route_t {
+    uint64_t addr;		/* IPv4 address, or upper 64 bits of IPv6, host order */
+    uint64_t addr_lo;		/* lower 64 bits of IPv6 */
+    u_short bitlen;
+    int value;
+} route_t;
+
 typedef struct _patricia_node_t {
    u_int bit;			/* flag if this node used */
    prefix_t *prefix;		/* who we are in patricia tree */
@@ -58,12 +70,17 @@ typedef struct _patricia_node_t {
    void *data;			/* pointer to data */
    void *user1;			/* pointer to usr data (ex. route flap info) */
 //   unsigned int children;
+   prefix_t pfx;		/* storage for prefix, never separately freed */
+   int value;			/* storage for small user1 payloads (ex. ASN) */
 } patricia_node_t;
 
 typedef struct _patricia_tree_t {
    patricia_node_t 	*head;
    u_int		maxbits;	/* for IP, 32 bit addresses */
    int num_active_node;		/* for debug purpose */
+   struct _patricia_arena_t *arena;	/* node chunks, freed in bulk */
+   u_int arena_used;		/* nodes handed out from newest chunk */
+   patricia_node_t *free_node;	/* removed nodes, chained by parent */
 } patricia_tree_t;
 
 
@@ -134,11 +151,16 @@ do { \
 
 class Patricia {
     public:
-    Patricia(uint8_t size) {
+    Patricia(uint8_t size) : flat(NULL), flat6(NULL), snap(NULL), snaplen(0) {
         tree = New_Patricia(size);
     };
     ~Patricia() {
         Destroy_Patricia(tree);
+        unmap();
+        if (flat)
+            delete flat;
+        if (flat6)
+            delete flat6;
     };
     template <typename Type> patricia_node_t *add_ref(const char *string, Type *val) {
         prefix_t *prefix = ascii2prefix(AF_INET, string);
@@ -158,7 +180,11 @@ class Patricia {
         if (node) {
             /* only set data if node didn't already exist */
             if (node->user1 == NULL) {
-                node->user1 = calloc(1, size);
+                /* small payloads live in the node itself */
+                if (size <= sizeof(node->value))
+                    node->user1 = &node->value;
+                else
+                    node->user1 = calloc(1, size);
                 memcpy(node->user1, val, size);
             }
         }
@@ -173,9 +199,18 @@ class Patricia {
     }
     void *get(uint32_t addr, bool exact);
     void *get(uint32_t addr) {
+        if (flat)
+            return flat->get(addr);
 		return (get(addr, false));
 	}
-    void *get(struct in6_addr addr);
+    void *get(struct in6_addr addr) {
+        if (flat6)
+            return flat6->get(&addr);
+        return (get6(addr));
+    }
+    /* get() of n addresses at once, out[i] for addrs[i] */
+    void get(const uint32_t *addrs, size_t n, int **out);
+    void get(const struct in6_addr *addrs, size_t n, int **out);
     void *get(int family, const char *string, bool exact);
     void *get(const char *string) {
         return (get(AF_INET, string, false));
@@ -192,16 +227,40 @@ class Patricia {
     void populate6(const char *filename) {
         populate(AF_INET6, filename);
     };
-    void populateStatus(const char *filename);
+    /* populate(), but reports unreadable input rather than exiting */
+    bool read(int family, const char *filename, bool block);
     int matchingPrefix(uint32_t addr);
     int matchingPrefix(const char *string, int family);
+    void routes(std::vector<route_t> &out);
+    void compile();
+    /* Compiled tables give each prefix a slot, 1..prefixes()-1; the slot
+       of the prefix whose value get() returned */
+    uint32_t prefix(const int *value) {
+        return flat ? flat->code(value) : flat6->code(value);
+    }
+    uint32_t prefixes() {
+        return flat ? flat->codes() : flat6 ? flat6->codes() : 0;
+    }
+    /* value (ASN) of the prefix in a slot */
+    int value(uint32_t slot) {
+        return flat ? flat->value(slot) : flat6->value(slot);
+    }
+    /* mmap'able snapshot of the compiled tables, keyed by input hash */
+    static uint64_t fingerprint(int family, const char *bgpfile, const char *blocklist);
+    bool save(const char *filename, uint64_t hash);
+    bool load(const char *filename, uint64_t hash);
 
     private:
-    int parseBGPLine(char *, std::string *, uint32_t *, int *);
-    int parsePrefix(int family, char *, std::string *);
     void *get(prefix_t *prefix, bool exact);
+    void *find(prefix_t *prefix, bool exact);
+    void *get6(struct in6_addr addr);
+    void unmap();
     int matchingPrefix(prefix_t *prefix);
     patricia_tree_t *tree;
+    Dir24 *flat;  /* compiled IPv4 lookups; stale if the trie changes */
+    Mtrie6 *flat6;  /* compiled IPv6 lookups, likewise */
+    void *snap;     /* mapped snapshot backing flat or flat6 */
+    size_t snaplen;
 };
 
 #endif /* _PATRICIA_H */
@@ -0,0 +1,57 @@
+#include "yarrp.h"
+#include "permutation.h"
+
+Permutation::Permutation() : perm(NULL), range(0), key_len(0), start(0), end(UINT64_MAX), head(0), tail(0) {
+}
+
+Permutation::~Permutation() {
+  if (perm)
+    cperm_destroy(perm);
+}
+
+bool Permutation::create(uint64_t _range, PermCipher _cipher, uint8_t *key, int _key_len) {
+  if (perm)
+    cperm_destroy(perm);
+  head = tail = 0;
+  range = _range;
+  cipher = _cipher;
+  key_len = _key_len;
+  start = 0;
+  end = UINT64_MAX;
+  perm = cperm_create(range, PERM_MODE_AUTO, cipher, key, key_len);
+  return perm != NULL;
+}
+
+bool Permutation::seek(uint64_t pos) {
+  head = tail = 0;
+  return cperm_seek(perm, pos) == 0;
+}
+
+bool Permutation::bounds(uint64_t _start, uint64_t _end) {
+  start = _start;
+  end = _end;
+  return seek(start);
+}
+
+bool Permutation::rekey(uint8_t *key) {
+  uint64_t s = start, e = end;
+  if (not create(range, cipher, key, key_len))
+    return false;
+  return bounds(s, e);
+}
+
+bool Permutation::refill() {
+  uint64_t pos = cperm_get_position(perm);
+  int n = PERM_BATCH;
+
+  if (pos >= end)
+    return false;
+  if (end - pos < PERM_BATCH)
+    n = end - pos;
+  n = cperm_next_batch(perm, buf, n);
+  if (n <= 0)
+    return false;
+  head = 0;
+  tail = n;
+  return true;
+}
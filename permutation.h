@@ -0,0 +1,59 @@
+/****************************************************************************
+   Program:     $Id: $
+   Date:        $Date: $
+   Description: buffered libcperm permutation
+****************************************************************************/
+
+#ifndef PERMUTATION_H
+#define PERMUTATION_H
+
+#include <stdint.h>
+#include "libcperm/cperm.h"
+
+/* Number of permutation values pulled from libcperm per refill */
+#define PERM_BATCH 16
+
+/*
+ * Wraps a libcperm permutation and hands out its values one at a time from
+ * a small buffer, refilled with cperm_next_batch().  The cipher then runs
+ * on PERM_BATCH consecutive indices at once, and the per-value cost is an
+ * inline buffer read rather than two indirect calls into libcperm.
+ */
+class Permutation {
+  public:
+  Permutation();
+  ~Permutation();
+
+  bool create(uint64_t range, PermCipher cipher, uint8_t *key, int key_len);
+  bool valid() { return perm != NULL; }
+
+  /* Next permutation value; false at the end of the permutation */
+  inline bool next(uint64_t *v) {
+    if (head == tail and not refill())
+      return false;
+    *v = buf[head++];
+    return true;
+  }
+
+  /* Index of the next value next() will return */
+  uint64_t position() { return cperm_get_position(perm) - (tail - head); }
+  bool seek(uint64_t pos);
+  /* Only hand out the values at indices [start, end) */
+  bool bounds(uint64_t start, uint64_t end);
+  /* Start over from the first index, permuting under a new key */
+  bool rekey(uint8_t *key);
+
+  private:
+  bool refill();
+  cperm_t *perm;
+  uint64_t range;
+  PermCipher cipher;
+  int key_len;
+  uint64_t start;
+  uint64_t end;
+  uint64_t buf[PERM_BATCH];
+  int head;
+  int tail;
+};
+
+#endif /* PERMUTATION_H */
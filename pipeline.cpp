@@ -0,0 +1,59 @@
+/****************************************************************************
+   Program:     $Id: $
+   Date:        $Date: $
+   Description: yarrp probing pipeline.  Rings and per-stage counters for
+                the generator, filter and sender stages.
+****************************************************************************/
+#include "yarrp.h"
+#include <sched.h>
+
+/* Yield while the other stages are busy, but sleep once they have been
+   idle a while, so slow scans don't burn cores */
+void
+Pipeline::stall(stage_t *s) {
+    struct timespec ts;
+
+    s->stalls++;
+    if (++s->idle < PIPELINE_SPIN) {
+        sched_yield();
+        return;
+    }
+    ts.tv_sec = 0;
+    ts.tv_nsec = PIPELINE_STALL * 1000;
+    nanosleep(&ts, NULL);
+}
+
+batch_t *
+Pipeline::next() {
+    batch_t *b;
+
+    while ((b = filtered.peek()) == NULL)
+        stall(&send);
+    send.occupancy += filtered.size();
+    return b;
+}
+
+void
+Pipeline::done(batch_t *b) {
+    send.batches++;
+    send.idle = 0;
+    send.pairs += b->n;
+    filtered.consume();
+}
+
+static void
+dump(FILE *out, const char *name, stage_t *s, bool input) {
+    fprintf(out, "# Stage_%s: %" PRIu64 " pairs, %" PRIu64 " batches, %.0f pairs/s, %" PRIu64 " stalls",
+            name, s->pairs, s->batches, s->time > 0 ? s->pairs / s->time : 0, s->stalls);
+    if (input and s->batches)
+        fprintf(out, ", ring %.1f", (double) s->occupancy / s->batches);
+    fprintf(out, "\n");
+}
+
+/* Trailer lines: per stage throughput, stalls and input ring occupancy */
+void
+Pipeline::dump(FILE *out) {
+    ::dump(out, "Generate", &gen, false);
+    ::dump(out, "Filter", &filt, true);
+    ::dump(out, "Send", &send, true);
+}
@@ -0,0 +1,107 @@
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+/* Batches per ring (power of 2) */
+#define PIPELINE_RING 64
+/* Waits on a full or empty ring a stage spins through before sleeping */
+#define PIPELINE_SPIN 1000
+/* Microseconds a stage then sleeps per wait */
+#define PIPELINE_STALL 50
+
+/* Up to LOOKUP_BATCH (target, TTL) pairs, as passed between stages */
+typedef struct {
+    uint32_t addr[LOOKUP_BATCH];
+    struct in6_addr addr6[LOOKUP_BATCH];
+    uint8_t ttl[LOOKUP_BATCH];
+    int *asn[LOOKUP_BATCH];       /* lookup results, from table */
+    uint64_t pos[LOOKUP_BATCH];   /* permutation position after each */
+    bool held[LOOKUP_BATCH];      /* released by the scheduler */
+    Patricia *table;              /* table the batch was looked up in */
+    bool filter;                  /* routed/blocklist checks still due */
+    bool last;                    /* permutation used up */
+    int n;
+} batch_t;
+
+/*
+ * Lock-free single-producer, single-consumer ring of batches.  Stages
+ * fill and drain slots in place: claim() a free slot and publish() it,
+ * or peek() at the oldest and consume() it.
+ */
+class BatchRing {
+    public:
+    BatchRing() : head(0), tail(0), slots(PIPELINE_RING) {};
+    batch_t *claim() {
+        if (head - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) == PIPELINE_RING)
+            return NULL;
+        return &slots[head & (PIPELINE_RING - 1)];
+    }
+    void publish() {
+        __atomic_store_n(&head, head + 1, __ATOMIC_RELEASE);
+    }
+    batch_t *peek() {
+        if (__atomic_load_n(&head, __ATOMIC_ACQUIRE) == tail)
+            return NULL;
+        return &slots[tail & (PIPELINE_RING - 1)];
+    }
+    void consume() {
+        __atomic_store_n(&tail, tail + 1, __ATOMIC_RELEASE);
+    }
+    uint64_t size() {
+        return __atomic_load_n(&head, __ATOMIC_ACQUIRE) - __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+    }
+
+    private:
+    uint64_t head;  /* written by the producer only */
+    char pad[64];   /* keep head and tail on separate cache lines */
+    uint64_t tail;  /* written by the consumer only */
+    std::vector<batch_t> slots;
+};
+
+/* Throughput and occupancy of one stage */
+typedef struct {
+    uint64_t batches;    /* batches handed on */
+    uint64_t pairs;      /* (target, TTL) pairs handed on */
+    uint64_t stalls;     /* waits on a full output or empty input ring */
+    uint64_t occupancy;  /* input ring batches, summed over batches taken */
+    double time;         /* seconds the stage ran */
+    uint32_t idle;       /* waits since the stage last handed a batch on */
+} stage_t;
+
+/*
+ * Pipelined probing: a generator stage draws batches from the permutation
+ * and applies the TTL, retry, TTL distribution and neighborhood checks; a
+ * filter stage looks them up in the BGP/blocklist table and drops the
+ * unrouted and blocked; the sending loop applies the checks that depend
+ * on replies so far, then builds, paces and sends the probes.  The stages
+ * run on their own threads, connected by two rings.
+ */
+class Pipeline {
+    public:
+    Pipeline() : stopped(false) {
+        memset(&gen, 0, sizeof(gen));
+        memset(&filt, 0, sizeof(filt));
+        memset(&send, 0, sizeof(send));
+    };
+    bool stopping() { return __atomic_load_n(&stopped, __ATOMIC_RELAXED); }
+    void stop() { __atomic_store_n(&stopped, true, __ATOMIC_RELAXED); }
+    void start() { stopped = false; }
+    void stall(stage_t *s);
+    /* Sender's next batch from the filter stage, and done with it */
+    batch_t *next();
+    void done(batch_t *b);
+    void dump(FILE *out);
+    BatchRing generated;  /* generator to filter */
+    BatchRing filtered;   /* filter to sender */
+    stage_t gen;
+    stage_t filt;
+    stage_t send;
+
+    private:
+    bool stopped;
+};
+
+#endif
@@ -12,7 +12,7 @@
 #include <pthread.h>
 #include <vector>
 #include <fstream>
-#include "libcperm/cperm.h"
+#include "permutation.h"
 
 #include "subnet_list.h"
 
@@ -27,36 +27,55 @@ class RandomSubnetList : public SubnetList {
   void seed();
   virtual uint32_t next_address(struct in_addr *in, uint8_t *ttl);
   virtual uint32_t next_address(struct in6_addr *in, uint8_t *ttl);
+  virtual uint64_t position();
+  virtual void seek(uint64_t pos);
+  virtual void shard(uint32_t k, uint32_t n);
+  virtual void rekey(uint32_t seed);
 
   private:
   uint16_t getHost(uint8_t *addr);
+  uint32_t locate(uint64_t next, uint64_t *offset);
   uint64_t rndIID(uint32_t *addr);
   uint8_t key[32];
   bool seeded;
-  cperm_t* perm;
+  Permutation perm;
 };
 
 class IPList {
   public:
   IPList(uint8_t _maxttl, bool _rand, bool _entire);
-  virtual ~IPList() {};
+  virtual ~IPList();
   virtual uint32_t next_address(struct in_addr *in, uint8_t * ttl) = 0;
   virtual uint32_t next_address(struct in6_addr *in, uint8_t * ttl) = 0;
   virtual void seed() = 0;
+  virtual void routed(Patricia *tree) = 0;
+  /* Index of a target's unit; reverse() first for input targets */
+  virtual bool index(uint32_t addr, uint64_t *unit) = 0;
+  virtual bool index(const struct in6_addr *addr, uint64_t *unit) = 0;
+  virtual void reverse() = 0;
+  void share(IPList *list);
   void read(char *in);
   virtual void read(std::istream& in) = 0;
-  uint32_t count() { return permsize; }
+  uint64_t count() { return permsize; }
   void setkey(int seed);
+  uint64_t position();
+  void seek(uint64_t pos);
+  void shard(uint32_t k, uint32_t n, uint32_t t = 0, uint32_t threads = 1);
+  void rekey(uint32_t seed);
 
   protected:
   uint8_t log2(uint8_t x);
   uint8_t key[KEYLEN];
-  cperm_t* perm;
+  Permutation perm;
+  RoutedIndex *routes;  /* entire mode: routed /24s (IPv4) or /48s (IPv6) */
+  bool ownroutes;
   uint64_t permsize;
+  uint64_t seq_pos;   /* sequential mode: next target * maxttl + ttl */
+  uint64_t seq_start;
+  uint64_t seq_end;
   uint8_t maxttl;
   uint8_t ttlbits;
   uint32_t ttlmask;
-  uint32_t ttlprefix;
   bool rand;
   bool entire;
   bool seeded;
@@ -73,9 +92,14 @@ class IPList4 : public IPList {
   uint32_t next_address(struct in6_addr *in, uint8_t * ttl) { return 0; };
   void read(std::istream& in);
   void seed();
+  void routed(Patricia *tree);
+  bool index(uint32_t addr, uint64_t *unit);
+  bool index(const struct in6_addr *addr, uint64_t *unit) { return false; };
+  void reverse();
 
   private:
   std::vector<uint32_t> targets;
+  std::vector<uint32_t> order;  /* target indices, sorted by address */
 };
 
 class IPList6 : public IPList {
@@ -89,9 +113,14 @@ class IPList6 : public IPList {
   uint32_t next_address(struct in_addr *in, uint8_t * ttl) { return 0; };
   void read(std::istream& in);
   void seed();
+  void routed(Patricia *tree);
+  bool index(const struct in6_addr *addr, uint64_t *unit);
+  bool index(uint32_t addr, uint64_t *unit) { return false; };
+  void reverse();
 
   private:
   std::vector<struct in6_addr> targets;
+  std::vector<uint32_t> order;  /* target indices, sorted by address */
 };
 
 #endif /* RANDOM_LIST_H */
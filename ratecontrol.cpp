@@ -0,0 +1,67 @@
+/****************************************************************************
+   Program:     $Id: $
+   Date:        $Date: $
+   Description: yarrp rate control.  Backs the probing rate off when the
+                reply ratio collapses or the kernel drops replies.
+****************************************************************************/
+#include "yarrp.h"
+
+RateControl::RateControl(uint32_t _rate, Stats *_stats) :
+    rate(_rate), stats(_stats), level(1000), probes(0), baseline(0),
+    last_probes(0), last_replies(0), last_drops(0) {
+    pthread_mutex_init(&lock, NULL);
+    next = now() + RATECTL_WINDOW;
+}
+
+RateControl::~RateControl() {
+    pthread_mutex_destroy(&lock);
+}
+
+/*
+ * Called by senders every so often; the first to find the window over
+ * (and the lock free) updates the rate
+ */
+void
+RateControl::tick() {
+    double t = now();
+    if (pthread_mutex_trylock(&lock) != 0)
+        return;
+    if (t >= next)
+        update(t);
+    pthread_mutex_unlock(&lock);
+}
+
+void
+RateControl::update(double t) {
+    uint64_t p = __atomic_load_n(&probes, __ATOMIC_RELAXED);
+    uint64_t r = __atomic_load_n(&stats->replies, __ATOMIC_RELAXED);
+    uint64_t d = __atomic_load_n(&stats->drops, __ATOMIC_RELAXED);
+    uint32_t lvl = level;
+    const char *why = NULL;
+
+    next = t + RATECTL_WINDOW;
+    /* Too few probes to judge; let the window grow */
+    if (p - last_probes < RATECTL_MIN_PROBES)
+        return;
+    double ratio = (double) (r - last_replies) / (p - last_probes);
+    if (d > last_drops)
+        why = "kernel drops";
+    else if (ratio < baseline * RATECTL_DROP)
+        why = "reply ratio";
+    if (why) {
+        lvl = max((uint32_t) (RATECTL_FLOOR * 1000), (uint32_t) (level * RATECTL_DECREASE));
+        stats->rate_backoffs++;
+    } else {
+        baseline = max(ratio, baseline * RATECTL_DECAY);
+        lvl = min((uint32_t) 1000, level + (uint32_t) (RATECTL_INCREASE * 1000));
+    }
+    if (lvl != level) {
+        fprintf(stderr, "# Rate: %" PRIu64 " pps, reply ratio %.3f (baseline %.3f), drops %" PRIu64 "%s%s\n",
+                (uint64_t) rate * lvl / 1000, ratio, baseline, d - last_drops,
+                why ? ", backing off on " : "", why ? why : "");
+        __atomic_store_n(&level, lvl, __ATOMIC_RELAXED);
+    }
+    last_probes = p;
+    last_replies = r;
+    last_drops = d;
+}
@@ -0,0 +1,60 @@
+#ifndef _RATECONTROL_H_
+#define _RATECONTROL_H_
+
+#include <stdint.h>
+#include <pthread.h>
+
+/* Seconds of probing per feedback window */
+#define RATECTL_WINDOW 2.0
+/* Fewest probes a window needs to be judged */
+#define RATECTL_MIN_PROBES 100
+/* Back off once the reply ratio falls below this fraction of its baseline */
+#define RATECTL_DROP 0.5
+/* Per-window multiplicative decrease and additive increase of the rate */
+#define RATECTL_DECREASE 0.5
+#define RATECTL_INCREASE 0.1
+/* Lowest fraction of the configured rate to back off to */
+#define RATECTL_FLOOR 0.05
+/* Per-window decay of the baseline reply ratio */
+#define RATECTL_DECAY 0.99
+
+/*
+ * AIMD control of the probing rate from reply feedback.  Each window, the
+ * ratio of replies received to probes sent is compared against a slowly
+ * decaying baseline of healthy windows.  When it collapses (ICMP rate
+ * limiting upstream) or the kernel reports receive drops (a congested
+ * uplink or listener), the rate is halved; otherwise it ramps back up by
+ * a tenth of the configured rate per window, up to the configured rate.
+ *
+ * Senders scale their share of the configured rate by scale(), and report
+ * the probes they send with sent(); whichever sender finds a window over
+ * makes the decision.  Decisions are logged to stderr with the progress
+ * stats.
+ */
+class RateControl {
+    public:
+    RateControl(uint32_t rate, Stats *stats);
+    ~RateControl();
+    double scale() {
+        return __atomic_load_n(&level, __ATOMIC_RELAXED) / 1000.0;
+    }
+    void sent(uint64_t n) {
+        __atomic_add_fetch(&probes, n, __ATOMIC_RELAXED);
+    }
+    void tick();
+
+    private:
+    void update(double t);
+    uint32_t rate;         /* configured rate, all senders */
+    Stats *stats;          /* listener's replies and drops */
+    uint32_t level;        /* current fraction of rate, per mille */
+    uint64_t probes;
+    pthread_mutex_t lock;  /* the rest is guarded by lock */
+    double next;
+    double baseline;
+    uint64_t last_probes;
+    uint64_t last_replies;
+    uint64_t last_drops;
+};
+
+#endif
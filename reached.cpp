@@ -0,0 +1,65 @@
+/****************************************************************************
+   Program:     $Id: $
+   Date:        $Date: $
+   Description: yarrp reached.  Lowest TTL at which each target has
+                answered; higher TTLs to it need not be probed.
+****************************************************************************/
+#include "yarrp.h"
+
+Reached::Reached(reached_key key, uint64_t targets, bool _highest) :
+    tbl4(NULL), tbl6(NULL), mask(0), highest(_highest) {
+    if (key == REACHED_PER24) {
+        if ((tbl4 = (uint8_t *) calloc(1 << 24, sizeof(uint8_t))) == NULL)
+            fatal("Cannot allocate reached table: %s", strerror(errno));
+        return;
+    }
+    int bits = REACHED_MIN6;
+    while (bits < REACHED_BITS6 and (1ULL << bits) < 2 * targets)
+        bits++;
+    mask = (1ULL << bits) - 1;
+    if ((tbl6 = (uint64_t *) calloc(mask + 1, sizeof(uint64_t))) == NULL)
+        fatal("Cannot allocate reached table: %s", strerror(errno));
+}
+
+Reached::~Reached() {
+    free(tbl4);
+    free(tbl6);
+}
+
+/*
+ * Target addr answered a probe sent with ttl; keep the lowest (highest) such TTL
+ */
+void
+Reached::add(uint32_t addr, uint8_t ttl) {
+    if (tbl4 == NULL) {
+        insert(hash(addr), ttl);
+        return;
+    }
+    uint8_t *r = &tbl4[ntohl(addr) >> 8];
+    uint8_t was = __atomic_load_n(r, __ATOMIC_RELAXED);
+    while (ttl and better(ttl, was)) {
+        if (__atomic_compare_exchange_n(r, &was, ttl, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            break;
+    }
+}
+
+void
+Reached::add(const struct in6_addr *addr, uint8_t ttl) {
+    insert(hash(addr), ttl);
+}
+
+void
+Reached::insert(uint64_t h, uint8_t ttl) {
+    uint64_t *r = &tbl6[(h >> 8) & mask];
+    uint64_t tag = h & ~0xffULL;
+    uint64_t was = __atomic_load_n(r, __ATOMIC_RELAXED);
+    while (ttl) {
+        /* Same target, already as low (high) */
+        if ((was & ~0xffULL) == tag and not better(ttl, was & 0xff))
+            break;
+        if (__atomic_compare_exchange_n(r, &was, tag | ttl, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            break;
+    }
+}
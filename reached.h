@@ -0,0 +1,73 @@
+#ifndef _REACHED_H_
+#define _REACHED_H_
+
+#include <stdint.h>
+#include <string.h>
+
+/* log2 of the largest IPv6 table, in 8-byte slots (32 MB) */
+#define REACHED_BITS6 22
+/* log2 of the smallest IPv6 table */
+#define REACHED_MIN6 10
+
+/* How IPv4 targets are keyed: per /24, or each on its own (as IPv6 always is) */
+typedef enum {REACHED_PER24, REACHED_PERTARGET} reached_key;
+
+/*
+ * Lowest TTL at which each target itself has answered (echo reply or
+ * destination unreachable), so the sender can skip the target's higher
+ * TTLs.  The listener fills it in and the senders read it, lock-free.
+ *
+ * In subnet and entire mode IPv4 keeps one byte per /24, the unit yarrp
+ * probes there (16 MB, touched only where targets answer).  Otherwise
+ * (input lists, IPv6, schedules) targets are kept per address, in a
+ * direct-mapped table of hash-tag|TTL words sized to the number of
+ * targets; a colliding target evicts the older entry, which only costs
+ * the probes the table would have saved.
+ *
+ * With highest set, the table keeps each target's highest TTL instead.
+ */
+class Reached {
+    public:
+    Reached(reached_key key, uint64_t targets, bool highest = false);
+    ~Reached();
+    void add(uint32_t addr, uint8_t ttl);
+    void add(const struct in6_addr *addr, uint8_t ttl);
+    /* TTL at which the target answered, or 0 */
+    uint8_t ttl(uint32_t addr) {
+        if (tbl4)
+            return __atomic_load_n(&tbl4[ntohl(addr) >> 8], __ATOMIC_RELAXED);
+        return lookup(hash(addr));
+    }
+    uint8_t ttl(const struct in6_addr *addr) {
+        return lookup(hash(addr));
+    }
+
+    static uint64_t hash(uint32_t addr) {
+        uint64_t h = (addr * 0x9e3779b97f4a7c15ULL) * 0xbf58476d1ce4e5b9ULL;
+        return h ^ (h >> 31);
+    }
+    static uint64_t hash(const struct in6_addr *addr) {
+        uint64_t hi, lo;
+        memcpy(&hi, addr->s6_addr, 8);
+        memcpy(&lo, addr->s6_addr + 8, 8);
+        uint64_t h = (hi ^ (lo * 0x9e3779b97f4a7c15ULL)) * 0xbf58476d1ce4e5b9ULL;
+        return h ^ (h >> 31);
+    }
+
+    private:
+    uint8_t lookup(uint64_t h) {
+        uint64_t e = __atomic_load_n(&tbl6[(h >> 8) & mask], __ATOMIC_RELAXED);
+        return ((e ^ h) >> 8) ? 0 : e & 0xff;
+    }
+    void insert(uint64_t h, uint8_t ttl);
+    /* Whether ttl should replace the stored TTL was (0: none) */
+    bool better(uint8_t ttl, uint8_t was) {
+        return was == 0 or (highest ? ttl > was : ttl < was);
+    }
+    uint8_t *tbl4;    /* /24 -> TTL, in subnet and entire mode */
+    uint64_t *tbl6;   /* per target: hash tag (high 56 bits) | TTL */
+    uint64_t mask;
+    bool highest;
+};
+
+#endif
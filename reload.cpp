@@ -0,0 +1,105 @@
+/****************************************************************************
+   Program:     $Id: $
+   Date:        $Date: $
+   Description: blocklist reload during a running scan
+****************************************************************************/
+#include "yarrp.h"
+#include <signal.h>
+
+static volatile sig_atomic_t reload_requested = 0;
+
+static void hupHandler(int dummy) {
+    reload_requested = 1;
+}
+
+Reload::Reload(YarrpConfig *_config, Patricia *_initial) : initial(_initial),
+    config(_config), current(_initial), generation(0), readers(0), running(false) {
+    for (int i = 0; i < MAX_THREADS; i++)
+        seen[i] = UINT64_MAX;
+}
+
+Reload::~Reload() {
+    stop();
+    if (current != initial)
+        delete current;
+}
+
+void Reload::start() {
+    running = true;
+    signal(SIGHUP, hupHandler);
+    if (pthread_create(&thread, NULL, run, this) != 0)
+        fatal("%s: cannot start reload thread", __func__);
+}
+
+void Reload::stop() {
+    if (not running)
+        return;
+    running = false;
+    pthread_join(thread, NULL);
+    signal(SIGHUP, SIG_DFL);
+}
+
+uint32_t Reload::join() {
+    uint32_t reader = __atomic_fetch_add(&readers, 1, __ATOMIC_SEQ_CST);
+    assert(reader < MAX_THREADS);
+    return reader;
+}
+
+void Reload::leave(uint32_t reader) {
+    __atomic_store_n(&seen[reader], UINT64_MAX, __ATOMIC_SEQ_CST);
+}
+
+/* Same table main() builds, from the files as they are now; NULL if
+   they can't be read, so a bad edit doesn't end the scan */
+Patricia *Reload::build() {
+    int family = config->ipv6 ? AF_INET6 : AF_INET;
+    Patricia *table = new Patricia(config->ipv6 ? 128 : 32);
+
+    if (not table->read(family, config->blocklist, true) or
+        (config->bgpfile and not table->read(family, config->bgpfile, false))) {
+        delete table;
+        return NULL;
+    }
+    if (not config->bgpfile)
+        table->add(family, config->ipv6 ? "::/0" : "0.0.0.0/0", 1);
+    table->compile();
+    return table;
+}
+
+/* Swap in table, then wait until no reader can still hold the old one */
+void Reload::publish(Patricia *table) {
+    Patricia *old = current;
+    __atomic_store_n(&current, table, __ATOMIC_SEQ_CST);
+    uint64_t g = __atomic_add_fetch(&generation, 1, __ATOMIC_SEQ_CST);
+    uint32_t n = __atomic_load_n(&readers, __ATOMIC_SEQ_CST);
+    for (uint32_t i = 0; i < n; i++) {
+        while (__atomic_load_n(&seen[i], __ATOMIC_SEQ_CST) < g)
+            usleep(1000);
+    }
+    /* main() owns the initial table */
+    if (old != initial)
+        delete old;
+}
+
+void *Reload::run(void *arg) {
+    Reload *reload = (Reload *) arg;
+    Patricia *table;
+    double t;
+
+    while (reload->running) {
+        usleep(RELOAD_POLL);
+        if (not reload_requested)
+            continue;
+        reload_requested = 0;
+        debug(LOW, ">> Reloading blocklist: " << reload->config->blocklist);
+        t = now();
+        table = reload->build();
+        if (table == NULL) {
+            warn("Blocklist reload failed; still using previous table");
+            continue;
+        }
+        reload->publish(table);
+        debug(LOW, ">> Blocklist reloaded in " << now() - t << "s");
+    }
+    return NULL;
+}
@@ -0,0 +1,55 @@
+/****************************************************************************
+   Program:     $Id: $
+   Date:        $Date: $
+   Description: blocklist reload during a running scan
+****************************************************************************/
+
+#ifndef RELOAD_H
+#define RELOAD_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+/* Microseconds between checks for a reload request */
+#define RELOAD_POLL 100000
+
+/*
+ * Rebuilds the BGP/blocklist lookup table from its files on SIGHUP, so
+ * opt-outs added to the blocklist take effect without restarting a scan.
+ * A background thread builds and compiles the new table, then publishes it
+ * by swapping a pointer; senders pick it up at their next batch and never
+ * wait on the rebuild.  A replaced table is freed only after every sender
+ * has acquired a newer one (a grace period, as in RCU).
+ */
+class Reload {
+  public:
+  Reload(YarrpConfig *_config, Patricia *_initial);
+  ~Reload();
+  void start();
+  void stop();
+  /* Sending threads register before acquiring and leave when done */
+  uint32_t join();
+  void leave(uint32_t reader);
+  /* Table for the reader's next batch; it's done with older tables */
+  inline Patricia *acquire(uint32_t reader) {
+    uint64_t g = __atomic_load_n(&generation, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&seen[reader], g, __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&current, __ATOMIC_SEQ_CST);
+  }
+
+  Patricia *initial;  /* table the scan started with */
+
+  private:
+  static void *run(void *arg);
+  Patricia *build();
+  void publish(Patricia *table);
+  YarrpConfig *config;
+  Patricia *current;
+  uint64_t generation;
+  uint64_t seen[MAX_THREADS];
+  uint32_t readers;
+  volatile bool running;
+  pthread_t thread;
+};
+
+#endif /* RELOAD_H */
@@ -0,0 +1,85 @@
+/****************************************************************************
+   Program:     $Id: $
+   Date:        $Date: $
+   Description: yarrp retry.  Bitmap of answered (target, TTL) probes, so
+                that retry passes re-send only the unanswered ones.
+****************************************************************************/
+#include "yarrp.h"
+#include "random_list.h"
+
+Retry::Retry(YarrpConfig *_config, IPList *_iplist, SubnetList *_subnetlist) :
+    config(_config), iplist(_iplist), subnetlist(_subnetlist), passes(0) {
+    size = iplist ? iplist->count() : subnetlist->count();
+    if ((bits = (uint64_t *) calloc((size + 63) / 64, sizeof(uint64_t))) == NULL)
+        fatal("Cannot allocate retry bitmap of %" PRIu64 " probes: %s", size, strerror(errno));
+    starts[0] = 0;
+}
+
+Retry::~Retry() {
+    free(bits);
+}
+
+/*
+ * Bit of the probe to target at ttl: each unit has maxttl bits, one per
+ * TTL the lists can hand out between minttl and maxttl
+ */
+bool
+Retry::bit(uint32_t target, uint8_t ttl, uint64_t *b) {
+    uint64_t unit;
+    if (ttl < config->minttl or ttl > config->maxttl)
+        return false;
+    if (not (iplist ? iplist->index(target, &unit) : subnetlist->index(target, &unit)))
+        return false;
+    *b = unit * config->maxttl + (ttl - config->minttl) % config->maxttl;
+    return *b < size;
+}
+
+bool
+Retry::bit(const struct in6_addr *target, uint8_t ttl, uint64_t *b) {
+    uint64_t unit;
+    if (ttl < config->minttl or ttl > config->maxttl)
+        return false;
+    if (not (iplist ? iplist->index(target, &unit) : subnetlist->index(target, &unit)))
+        return false;
+    *b = unit * config->maxttl + (ttl - config->minttl) % config->maxttl;
+    return *b < size;
+}
+
+/*
+ * A valid reply to the probe sent to target with ttl arrived
+ */
+void
+Retry::answered(uint32_t target, uint8_t ttl) {
+    uint64_t b;
+    if (bit(target, ttl, &b))
+        __atomic_fetch_or(&bits[b >> 6], 1ULL << (b & 63), __ATOMIC_RELAXED);
+}
+
+void
+Retry::answered(const struct in6_addr *target, uint8_t ttl) {
+    uint64_t b;
+    if (bit(target, ttl, &b))
+        __atomic_fetch_or(&bits[b >> 6], 1ULL << (b & 63), __ATOMIC_RELAXED);
+}
+
+/*
+ * Begin the next retry pass at elapsed time elapsed
+ */
+void
+Retry::next(uint32_t elapsed) {
+    uint8_t p = passes + 1;
+    assert(p <= RETRY_MAX);
+    starts[p] = elapsed;
+    __atomic_store_n(&passes, p, __ATOMIC_RELEASE);
+}
+
+/*
+ * Pass during which a probe sent at elapsed time sent went out
+ */
+uint8_t
+Retry::attempt(uint32_t sent) {
+    uint8_t p = pass();
+    while (p > 0 and sent < starts[p])
+        p--;
+    return p;
+}
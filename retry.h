@@ -0,0 +1,58 @@
+#ifndef _RETRY_H_
+#define _RETRY_H_
+
+#include <stdint.h>
+
+/* Most retry passes */
+#define RETRY_MAX 8
+/* Seconds to wait for replies before a retry pass */
+#define RETRY_WAIT 10
+
+class IPList;
+class SubnetList;
+
+/*
+ * Which (target, TTL) probes drew a valid reply, one bit per index of the
+ * target list's permutation space.  The listener sets bits as replies
+ * arrive; after the scan, retry passes re-send only the probes whose bit
+ * is still clear.  Targets map to their unit (target index, routed /24 or
+ * /48, or subnet /24 or granularity unit) through the target list.
+ *
+ * Replies are tagged with the pass their probe went out in, from its send
+ * time (the reply's elapsed time less the RTT encoded in the probe).
+ */
+class Retry {
+    public:
+    Retry(YarrpConfig *config, IPList *iplist, SubnetList *subnetlist);
+    ~Retry();
+    void answered(uint32_t target, uint8_t ttl);
+    void answered(const struct in6_addr *target, uint8_t ttl);
+    /* Whether to send the probe in this pass */
+    bool pending(uint32_t target, uint8_t ttl) {
+        uint64_t b;
+        return not bit(target, ttl, &b) or not test(b);
+    }
+    bool pending(const struct in6_addr *target, uint8_t ttl) {
+        uint64_t b;
+        return not bit(target, ttl, &b) or not test(b);
+    }
+    void next(uint32_t elapsed);
+    uint8_t pass() { return __atomic_load_n(&passes, __ATOMIC_ACQUIRE); }
+    uint8_t attempt(uint32_t sent);
+
+    private:
+    bool bit(uint32_t target, uint8_t ttl, uint64_t *b);
+    bool bit(const struct in6_addr *target, uint8_t ttl, uint64_t *b);
+    bool test(uint64_t b) {
+        return __atomic_load_n(&bits[b >> 6], __ATOMIC_RELAXED) & (1ULL << (b & 63));
+    }
+    YarrpConfig *config;
+    IPList *iplist;
+    SubnetList *subnetlist;
+    uint64_t *bits;
+    uint64_t size;
+    uint32_t starts[RETRY_MAX + 1];  /* elapsed time each pass began */
+    uint8_t passes;                  /* retry passes begun */
+};
+
+#endif
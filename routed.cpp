@@ -0,0 +1,128 @@
+/****************************************************************************
+   Program:     $Id: $
+   Date:        $Date: $
+   Description: dense index over routed address space
+****************************************************************************/
+#include "yarrp.h"
+
+/* A prefix widened to the units it covers */
+struct span_t {
+    uint64_t first;
+    uint64_t last;
+    int value;
+    u_short bitlen;
+};
+
+static bool span_order(const span_t &a, const span_t &b) {
+    if (a.first != b.first)
+        return a.first < b.first;
+    return a.bitlen < b.bitlen;
+}
+
+void
+RoutedIndex::build(Patricia *tree, uint8_t maxbits, uint8_t unitbits,
+                   bool (*routed)(Patricia *, uint64_t)) {
+    std::vector<route_t> routes;
+    std::vector<span_t> spans, stack, flat;
+    std::vector<uint64_t> mixed;
+    uint8_t shift = maxbits - unitbits;
+    uint64_t cursor = 0, cur;
+    size_t m = 0;
+    span_t s;
+
+    tree->routes(routes);
+    for (size_t i = 0; i < routes.size(); i++) {
+        s.first = routes[i].addr >> shift;
+        if (routes[i].bitlen > unitbits) {
+            mixed.push_back(s.first);
+            continue;
+        }
+        s.last = s.first + ((1ULL << (unitbits - routes[i].bitlen)) - 1);
+        s.value = routes[i].value;
+        s.bitlen = routes[i].bitlen;
+        spans.push_back(s);
+    }
+    std::sort(spans.begin(), spans.end(), span_order);
+    std::sort(mixed.begin(), mixed.end());
+    mixed.erase(std::unique(mixed.begin(), mixed.end()), mixed.end());
+
+    /* Prefixes nest, so a stack sweep yields disjoint runs of units, each
+       carrying the value of its most specific covering prefix */
+    for (size_t i = 0; i <= spans.size(); i++) {
+        while (not stack.empty() and
+               (i == spans.size() or stack.back().last < spans[i].first)) {
+            s = stack.back();
+            if (cursor <= s.last) {
+                s.first = cursor;
+                flat.push_back(s);
+            }
+            cursor = s.last + 1;
+            stack.pop_back();
+        }
+        if (i == spans.size())
+            break;
+        if (not stack.empty() and cursor < spans[i].first) {
+            s = stack.back();
+            s.first = cursor;
+            s.last = spans[i].first - 1;
+            flat.push_back(s);
+        }
+        cursor = spans[i].first;
+        stack.push_back(spans[i]);
+    }
+
+    /* Keep routed (non-zero, i.e. not blocked) runs, splitting out any unit
+       that holds a longer prefix so it can be decided on its own */
+    for (size_t i = 0; i < flat.size(); i++) {
+        while (m < mixed.size() and mixed[m] < flat[i].first) {
+            if (routed(tree, mixed[m]))
+                append(mixed[m], mixed[m]);
+            m++;
+        }
+        cur = flat[i].first;
+        while (m < mixed.size() and mixed[m] <= flat[i].last) {
+            if (flat[i].value != 0 and cur < mixed[m])
+                append(cur, mixed[m] - 1);
+            if (routed(tree, mixed[m]))
+                append(mixed[m], mixed[m]);
+            cur = mixed[m] + 1;
+            m++;
+        }
+        if (flat[i].value != 0 and cur <= flat[i].last)
+            append(cur, flat[i].last);
+    }
+    for (; m < mixed.size(); m++) {
+        if (routed(tree, mixed[m]))
+            append(mixed[m], mixed[m]);
+    }
+    debug(LOW, ">> Routed units: " << total << " in " << firsts.size() << " runs");
+}
+
+void
+RoutedIndex::append(uint64_t first, uint64_t last) {
+    if (not firsts.empty() and firsts.back() + (total - bases.back()) == first) {
+        total += last - first + 1;
+        return;
+    }
+    firsts.push_back(first);
+    bases.push_back(total);
+    total += last - first + 1;
+}
+
+/* Inverse of unit(): the index of a routed unit */
+bool
+RoutedIndex::index(uint64_t unit, uint64_t *index) {
+    size_t i = std::upper_bound(firsts.begin(), firsts.end(), unit) - firsts.begin();
+    if (i == 0)
+        return false;
+    i--;
+    *index = bases[i] + (unit - firsts[i]);
+    return *index < (i + 1 < bases.size() ? bases[i + 1] : total);
+}
+
+/* The index-th routed unit */
+uint64_t
+RoutedIndex::unit(uint64_t index) {
+    size_t i = std::upper_bound(bases.begin(), bases.end(), index) - bases.begin() - 1;
+    return firsts[i] + (index - bases[i]);
+}
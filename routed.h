@@ -0,0 +1,38 @@
+/****************************************************************************
+   Program:     $Id: $
+   Date:        $Date: $
+   Description: dense index over routed address space
+****************************************************************************/
+
+#ifndef ROUTED_H
+#define ROUTED_H
+
+#include <stdint.h>
+#include <vector>
+
+/*
+ * Numbers the routed units (e.g. /24s) of a BGP trie 0..count()-1, so a
+ * permutation can run over routed space only instead of rejecting unrouted
+ * draws.  Routed units are kept as sorted runs together with the index of
+ * each run's first unit; unit() binary searches those prefix sums.
+ */
+class RoutedIndex {
+  public:
+  RoutedIndex() : total(0) {};
+  /* Units are the top unitbits of the maxbits-wide route_t addr.  Units
+     holding a prefix longer than unitbits are decided by routed(). */
+  void build(Patricia *tree, uint8_t maxbits, uint8_t unitbits,
+             bool (*routed)(Patricia *, uint64_t));
+  uint64_t count() { return total; }
+  uint64_t runs() { return firsts.size(); }
+  uint64_t unit(uint64_t index);
+  bool index(uint64_t unit, uint64_t *index);
+
+  private:
+  void append(uint64_t first, uint64_t last);
+  std::vector<uint64_t> firsts;   /* first unit of each run */
+  std::vector<uint64_t> bases;    /* index of each run's first unit */
+  uint64_t total;
+};
+
+#endif /* ROUTED_H */
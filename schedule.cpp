@@ -0,0 +1,230 @@
+/****************************************************************************
+   Program:     $Id: $
+   Date:        $Date: $
+   Description: yarrp compiled probe schedules.  Writes the filtered
+                (target, TTL) stream of a scan, and plays it back mapped.
+****************************************************************************/
+#include "yarrp.h"
+#include "snapshot.h"
+#include <sys/mman.h>
+
+ScheduleWriter::ScheduleWriter(YarrpConfig *_config, uint64_t hash) :
+    config(_config), tmp(std::string(_config->compile) + ".tmp"), offset(0), n(0) {
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, SCHED_MAGIC, sizeof(hdr.magic));
+    hdr.family = config->ipv6 ? AF_INET6 : AF_INET;
+    hdr.block = SCHED_BLOCK;
+    hdr.hash = hash;
+    hdr.seed = config->seed;
+    hdr.minttl = config->minttl;
+    hdr.maxttl = config->maxttl;
+    prev[0] = prev[1] = 0;
+    f = fopen(tmp.c_str(), "w");
+    if (f == NULL)
+        fatal("%s: cannot open %s: %s", __func__, tmp.c_str(), strerror(errno));
+    /* header is rewritten once the counts are known */
+    if (not snap_write(f, &hdr, sizeof(hdr)))
+        fatal("Cannot write schedule %s: %s", tmp.c_str(), strerror(errno));
+    offset = snap_pad(sizeof(hdr));
+}
+
+ScheduleWriter::~ScheduleWriter() {
+    if (f) {
+        fclose(f);
+        unlink(tmp.c_str());
+    }
+}
+
+void
+ScheduleWriter::put(uint64_t v) {
+    while (v >= 0x80) {
+        buf.push_back((v & 0x7f) | 0x80);
+        v >>= 7;
+    }
+    buf.push_back(v);
+}
+
+void
+ScheduleWriter::add(uint32_t target, uint8_t ttl) {
+    uint64_t t = ntohl(target);
+    int64_t d = (int64_t) t - (int64_t) prev[0];
+
+    put(((uint64_t) d << 1) ^ (uint64_t) (d >> 63));
+    buf.push_back(ttl);
+    prev[0] = t;
+    hdr.pairs++;
+    if (++n == SCHED_BLOCK)
+        flush();
+}
+
+void
+ScheduleWriter::add(const struct in6_addr *target, uint8_t ttl) {
+    uint64_t t[2];
+    int64_t d;
+
+    t[0] = ((uint64_t) ntohl(target->s6_addr32[0]) << 32) | ntohl(target->s6_addr32[1]);
+    t[1] = ((uint64_t) ntohl(target->s6_addr32[2]) << 32) | ntohl(target->s6_addr32[3]);
+    for (int i = 0; i < 2; i++) {
+        d = (int64_t) (t[i] - prev[i]);
+        put(((uint64_t) d << 1) ^ (uint64_t) (d >> 63));
+        prev[i] = t[i];
+    }
+    buf.push_back(ttl);
+    hdr.pairs++;
+    if (++n == SCHED_BLOCK)
+        flush();
+}
+
+/* Write out the current block; the next one codes from zero again */
+void
+ScheduleWriter::flush() {
+    if (n == 0)
+        return;
+    if (fwrite(&buf[0], 1, buf.size(), f) != buf.size())
+        fatal("Cannot write schedule %s: %s", tmp.c_str(), strerror(errno));
+    index.push_back(offset);
+    offset += buf.size();
+    hdr.blocks++;
+    buf.clear();
+    n = 0;
+    prev[0] = prev[1] = 0;
+}
+
+/* Append the block index, fill in the header and rename into place */
+void
+ScheduleWriter::finish() {
+    static const char zero[SNAP_ALIGN] = {0};
+    size_t pad;
+
+    flush();
+    pad = snap_pad(offset) - offset;
+    if (pad and fwrite(zero, 1, pad, f) != pad)
+        fatal("Cannot write schedule %s: %s", tmp.c_str(), strerror(errno));
+    hdr.index = offset = snap_pad(offset);
+    if (not snap_write(f, index.empty() ? NULL : &index[0], index.size() * sizeof(uint64_t)))
+        fatal("Cannot write schedule %s: %s", tmp.c_str(), strerror(errno));
+    offset += snap_pad(index.size() * sizeof(uint64_t));
+    if (fseek(f, 0, SEEK_SET) != 0 or fwrite(&hdr, sizeof(hdr), 1, f) != 1 or
+        fclose(f) != 0) {
+        f = NULL;
+        fatal("Cannot write schedule %s: %s", tmp.c_str(), strerror(errno));
+    }
+    f = NULL;
+    if (rename(tmp.c_str(), config->compile) < 0)
+        fatal("Cannot rename %s to %s: %s", tmp.c_str(), config->compile, strerror(errno));
+}
+
+/* Map a compiled schedule; the scan adopts its seed and TTL range */
+Schedule::Schedule(YarrpConfig *config) : map(NULL), maplen(0), p(NULL), pos(0) {
+    const char *filename = config->schedule;
+    struct stat st;
+    int fd = open(filename, O_RDONLY);
+
+    if (fd < 0)
+        fatal("%s: cannot open %s: %s", __func__, filename, strerror(errno));
+    if (fstat(fd, &st) < 0 or (size_t) st.st_size < sizeof(sched_hdr_t))
+        fatal("%s is not a yarrp schedule", filename);
+    maplen = st.st_size;
+    map = mmap(NULL, maplen, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        fatal("%s: cannot map %s: %s", __func__, filename, strerror(errno));
+    madvise(map, maplen, MADV_SEQUENTIAL);
+    hdr = (const sched_hdr_t *) map;
+    if (memcmp(hdr->magic, SCHED_MAGIC, sizeof(hdr->magic)) != 0 or hdr->block == 0 or
+        hdr->blocks != (hdr->pairs + hdr->block - 1) / hdr->block or
+        hdr->index > maplen or hdr->blocks > (maplen - hdr->index) / sizeof(uint64_t))
+        fatal("%s is not a yarrp schedule", filename);
+    if (hdr->family != (uint32_t) (config->ipv6 ? AF_INET6 : AF_INET))
+        fatal("Schedule %s is IPv%d, probe type is IPv%d", filename,
+              hdr->family == AF_INET6 ? 6 : 4, config->ipv6 ? 6 : 4);
+    index = (const uint64_t *) ((const char *) map + hdr->index);
+    end = hdr->pairs;
+    prev[0] = prev[1] = 0;
+    config->seed = hdr->seed;
+    config->minttl = hdr->minttl;
+    config->maxttl = hdr->maxttl;
+    config->set("Seed", to_string(config->seed), true);
+    config->set("Min_TTL", to_string(config->minttl), true);
+    config->set("Max_TTL", to_string(config->maxttl), true);
+    debug(LOW, ">> Schedule " << filename << ": " << hdr->pairs << " pairs in "
+          << hdr->blocks << " blocks");
+}
+
+Schedule::~Schedule() {
+    munmap(map, maplen);
+}
+
+/* Advance to the next pair, opening its block if it starts one */
+bool
+Schedule::step() {
+    uint64_t b;
+
+    if (pos >= end)
+        return false;
+    if (pos % hdr->block == 0 or p == NULL) {
+        b = pos / hdr->block;
+        if (index[b] >= hdr->index)
+            fatal("Corrupt schedule block %" PRIu64, b);
+        p = (const uint8_t *) map + index[b];
+        prev[0] = prev[1] = 0;
+    }
+    pos++;
+    return true;
+}
+
+uint32_t
+Schedule::next_address(struct in_addr *in, uint8_t *ttl) {
+    if (not step())
+        return 0;
+    prev[0] += delta();
+    in->s_addr = htonl((uint32_t) prev[0]);
+    *ttl = *p++ - hdr->minttl;
+    return 1;
+}
+
+uint32_t
+Schedule::next_address(struct in6_addr *in, uint8_t *ttl) {
+    if (not step())
+        return 0;
+    prev[0] += delta();
+    prev[1] += delta();
+    in->s6_addr32[0] = htonl(prev[0] >> 32);
+    in->s6_addr32[1] = htonl(prev[0]);
+    in->s6_addr32[2] = htonl(prev[1] >> 32);
+    in->s6_addr32[3] = htonl(prev[1]);
+    *ttl = *p++ - hdr->minttl;
+    return 1;
+}
+
+/* Continue from a previous position(): decode into its block */
+void
+Schedule::seek(uint64_t to) {
+    struct in_addr in;
+    struct in6_addr in6;
+    uint8_t ttl;
+
+    if (to > hdr->pairs)
+        fatal("Cannot seek to position %" PRIu64 " of %" PRIu64, to, hdr->pairs);
+    pos = to - to % hdr->block;
+    p = NULL;
+    while (pos < to) {
+        if ((hdr->family == AF_INET6 ? next_address(&in6, &ttl) : next_address(&in, &ttl)) == 0) {
+            /* past the end of this shard: nothing left to play */
+            pos = to;
+            break;
+        }
+    }
+}
+
+/* Restrict playback to the k-th of n contiguous runs of blocks */
+void
+Schedule::shard(uint32_t k, uint32_t n) {
+    uint64_t start = hdr->blocks / n * k + min((uint64_t)k, hdr->blocks % n);
+
+    end = start + hdr->blocks / n + (k < hdr->blocks % n ? 1 : 0);
+    start *= hdr->block;
+    end = min(end * hdr->block, hdr->pairs);
+    debug(LOW, ">> Shard " << k << "/" << n << ": pairs [" << start << ", " << end << ")");
+    seek(start);
+}
@@ -0,0 +1,104 @@
+#ifndef _SCHEDULE_H_
+#define _SCHEDULE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#define SCHED_MAGIC "YRPSCH1"
+/* (target, TTL) pairs per block; blocks decode on their own */
+#define SCHED_BLOCK 4096
+
+/*
+ * Compiled probe schedule: the (target, TTL) pairs a scan's permutation
+ * yields once the TTL, TTL distribution, routed and blocklist checks have
+ * run, in scan order.  Pairs are grouped in blocks of SCHED_BLOCK; within
+ * a block each target is coded as the zigzag varint difference from the
+ * one before (IPv6 as the differences of its top and bottom 64 bits),
+ * followed by its TTL byte.  An index of block offsets follows the
+ * blocks, so a player can start at any block.
+ */
+typedef struct _sched_hdr_t {
+    char magic[8];
+    uint32_t family;
+    uint32_t block;    /* pairs per block */
+    uint64_t pairs;
+    uint64_t blocks;
+    uint64_t index;    /* file offset of the block offsets */
+    uint64_t hash;     /* of the BGP table and blocklist read */
+    uint32_t seed;
+    uint8_t minttl;
+    uint8_t maxttl;
+    uint8_t pad[2];
+} sched_hdr_t;
+
+/* Writes a schedule, via a temporary file renamed into place */
+class ScheduleWriter {
+    public:
+    ScheduleWriter(YarrpConfig *config, uint64_t hash);
+    ~ScheduleWriter();
+    void add(uint32_t target, uint8_t ttl);
+    void add(const struct in6_addr *target, uint8_t ttl);
+    void finish();
+    uint64_t pairs() { return hdr.pairs; }
+    uint64_t blocks() { return hdr.blocks; }
+    uint64_t size() { return offset; }
+
+    private:
+    void put(uint64_t v);
+    void flush();
+    YarrpConfig *config;
+    std::string tmp;
+    FILE *f;
+    sched_hdr_t hdr;
+    std::vector<uint8_t> buf;     /* block being coded */
+    std::vector<uint64_t> index;  /* file offset of each block */
+    uint64_t offset;
+    uint32_t n;                   /* pairs in the current block */
+    uint64_t prev[2];
+};
+
+/*
+ * Plays a mapped schedule back in order, as a target list: positions are
+ * pair indices, so checkpoints resume from the block holding the position
+ * and shards split the blocks.
+ */
+class Schedule {
+    public:
+    Schedule(YarrpConfig *config);
+    ~Schedule();
+    uint32_t next_address(struct in_addr *in, uint8_t *ttl);
+    uint32_t next_address(struct in6_addr *in, uint8_t *ttl);
+    uint64_t position() { return pos; }
+    void seek(uint64_t pos);
+    void shard(uint32_t k, uint32_t n);
+    uint64_t count() { return hdr->pairs; }
+
+    private:
+    uint64_t get() {
+        uint64_t v = 0;
+        int shift = 0;
+        while (*p & 0x80) {
+            v |= (uint64_t) (*p++ & 0x7f) << shift;
+            shift += 7;
+        }
+        return v | ((uint64_t) *p++ << shift);
+    }
+    /* zigzag: small differences either way code to small varints */
+    int64_t delta() {
+        uint64_t v = get();
+        return (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+    }
+    bool step();
+    void *map;
+    size_t maplen;
+    const sched_hdr_t *hdr;
+    const uint64_t *index;
+    const uint8_t *p;     /* next pair's code */
+    uint64_t pos;         /* pair index */
+    uint64_t end;         /* of this shard */
+    uint64_t prev[2];
+};
+
+#endif
@@ -0,0 +1,159 @@
+/****************************************************************************
+   Program:     $Id: $
+   Date:        $Date: $
+   Description: yarrp probe scheduler.  Holds probes back to per-hop and
+                per-prefix budgets, so rate-limiting routers still answer.
+****************************************************************************/
+#include "yarrp.h"
+#include <float.h>
+
+/* Sleep until time t, on the now() clock */
+static void
+sleepuntil(double t) {
+    struct timespec ts;
+    double d = t - now();
+
+    if (d <= 0)
+        return;
+    ts.tv_sec = (time_t) d;
+    ts.tv_nsec = (long) ((d - ts.tv_sec) * 1e9);
+    nanosleep(&ts, NULL);
+}
+
+Scheduler::Scheduler(YarrpConfig *_config, Stats *_stats) :
+    config(_config), stats(_stats), prefix(SCHED_SLOTS, 0.0),
+    ring(SCHED_HELD), head(0), tail(0), held(0), soonest(0) {
+    near = config->ttl_neighborhood ? config->ttl_neighborhood : SCHED_NEAR;
+    interval = 1.0 / config->budget;
+    burst = (SCHED_BURST - 1) * interval;
+    for (int i = 0; i <= UINT8_MAX; i++)
+        hop[i] = 0;
+}
+
+/* Prefix budget: the destination's AS from the BGP table, else its /16 */
+uint32_t
+Scheduler::key(uint32_t target, const int *asn) {
+    if (config->bgpfile and asn and *asn > 0)
+        return (*asn ^ (*asn >> 16)) & (SCHED_SLOTS - 1);
+    return ntohl(target) >> 16;
+}
+
+/* ... or, for IPv6, its /32 */
+uint32_t
+Scheduler::key(const struct in6_addr *target, const int *asn) {
+    uint32_t k;
+
+    if (config->bgpfile and asn and *asn > 0)
+        k = *asn;
+    else
+        k = ntohl(target->s6_addr32[0]);
+    return (k ^ (k >> 16)) & (SCHED_SLOTS - 1);
+}
+
+bool
+Scheduler::admit(uint32_t target, uint8_t ttl, const int *asn) {
+    struct in6_addr t;
+
+    memset(&t, 0, sizeof(t));
+    t.s6_addr32[0] = target;
+    return admit(&t, key(target, asn), ttl);
+}
+
+bool
+Scheduler::admit(const struct in6_addr *target, uint8_t ttl, const int *asn) {
+    return admit(target, key(target, asn), ttl);
+}
+
+bool
+Scheduler::admit(const struct in6_addr *target, uint32_t slot, uint8_t ttl) {
+    double t = now();
+    double r = ready(ttl, slot);
+    held_probe_t *p;
+
+    if (r > t and tail - head < SCHED_HELD) {
+        p = &ring[tail++ & (SCHED_HELD - 1)];
+        p->target = *target;
+        p->slot = slot;
+        p->ttl = ttl;
+        p->used = true;
+        soonest = held++ ? min(soonest, r) : r;
+        stats->deferred++;
+        return false;
+    }
+    /* Nowhere to hold it; wait for the budget rather than drop the probe */
+    if (r > t) {
+        sleepuntil(r);
+        t = now();
+    }
+    charge(ttl, slot, t);
+    return true;
+}
+
+void
+Scheduler::charge(uint8_t ttl, uint32_t slot, double t) {
+    prefix[slot] = max(prefix[slot], t) + interval;
+    if (ttl < near)
+        hop[ttl] = max(hop[ttl], t) + interval;
+}
+
+/*
+ * Oldest of the first SCHED_SCAN held probes that is within budget, now
+ * charged to it.  soonest remembers when the next one will be, so that
+ * senders only rescan once one might be.
+ */
+held_probe_t *
+Scheduler::release(bool wait) {
+    held_probe_t *p;
+    uint32_t i, seen;
+    double t, r;
+
+    while (held) {
+        t = now();
+        if (t >= soonest) {
+            soonest = DBL_MAX;
+            for (i = head, seen = 0; i != tail and seen < SCHED_SCAN; i++) {
+                p = &ring[i & (SCHED_HELD - 1)];
+                if (not p->used)
+                    continue;
+                seen++;
+                r = ready(p->ttl, p->slot);
+                if (r <= t) {
+                    p->used = false;
+                    held--;
+                    while (head != tail and not ring[head & (SCHED_HELD - 1)].used)
+                        head++;
+                    charge(p->ttl, p->slot, t);
+                    soonest = 0;
+                    return p;
+                }
+                soonest = min(soonest, r);
+            }
+        }
+        if (not wait)
+            break;
+        sleepuntil(soonest);
+    }
+    return NULL;
+}
+
+bool
+Scheduler::release(uint32_t *target, uint8_t *ttl, bool wait) {
+    held_probe_t *p = release(wait);
+
+    if (p == NULL)
+        return false;
+    *target = p->target.s6_addr32[0];
+    *ttl = p->ttl;
+    return true;
+}
+
+bool
+Scheduler::release(struct in6_addr *target, uint8_t *ttl, bool wait) {
+    held_probe_t *p = release(wait);
+
+    if (p == NULL)
+        return false;
+    *target = p->target;
+    *ttl = p->ttl;
+    return true;
+}
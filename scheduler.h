@@ -0,0 +1,82 @@
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#include <stdint.h>
+#include <vector>
+
+/* TTLs below this are budgeted per hop when no neighborhood TTL is set */
+#define SCHED_NEAR 4
+/* Prefix budgets: one per IPv4 /16, hashed for ASNs and IPv6 /32s */
+#define SCHED_SLOTS 65536
+/* Most probes held back at once (power of 2) */
+#define SCHED_HELD 4096
+/* Oldest held probes looked at for one within budget */
+#define SCHED_SCAN 256
+/* Probes a hop or prefix may receive back-to-back */
+#define SCHED_BURST 4
+
+/* A probe held back for its budget */
+typedef struct {
+    struct in6_addr target;  /* IPv4 targets in the first word */
+    uint32_t slot;           /* prefix budget */
+    uint8_t ttl;
+    bool used;               /* false once released */
+} held_probe_t;
+
+/*
+ * Per-hop and per-prefix probe budgets, so that routers rate-limiting ICMP
+ * generation see no more than --hop-budget probes per second from yarrp.
+ * Random ordering spreads probes over destinations, but every TTL 1 probe
+ * still expires at the same first-hop router, and every probe toward one
+ * network crosses its few border routers.
+ *
+ * Each TTL inside the neighborhood (-n, or below SCHED_NEAR) has a budget,
+ * as does each destination AS (with a BGP table) or /16 (/32 for IPv6).
+ * Budgets are GCRA token buckets: a probe is within budget when neither
+ * its hop's nor its prefix's theoretical arrival time is more than
+ * SCHED_BURST probes ahead of now.  Probes over budget are held back in a
+ * bounded reorder buffer, and released, oldest first, once within it.
+ * Once the buffer is full, the sender waits for the budget instead, so
+ * nothing is dropped; the scan then slows to what the budgets allow.
+ *
+ * Each sender has its own scheduler and its share of the budget.
+ */
+class Scheduler {
+    public:
+    Scheduler(YarrpConfig *config, Stats *stats);
+    /* Whether to send a probe now; if not, it is held back */
+    bool admit(uint32_t target, uint8_t ttl, const int *asn);
+    bool admit(const struct in6_addr *target, uint8_t ttl, const int *asn);
+    /* A held probe now within budget; with wait, the next to be */
+    bool release(uint32_t *target, uint8_t *ttl, bool wait);
+    bool release(struct in6_addr *target, uint8_t *ttl, bool wait);
+    bool empty() { return held == 0; }
+
+    private:
+    uint32_t key(uint32_t target, const int *asn);
+    uint32_t key(const struct in6_addr *target, const int *asn);
+    bool admit(const struct in6_addr *target, uint32_t slot, uint8_t ttl);
+    held_probe_t *release(bool wait);
+    /* Earliest time a probe of this hop and prefix is within budget */
+    double ready(uint8_t ttl, uint32_t slot) {
+        double r = prefix[slot];
+        if (ttl < near and hop[ttl] > r)
+            r = hop[ttl];
+        return r - burst;
+    }
+    void charge(uint8_t ttl, uint32_t slot, double t);
+    YarrpConfig *config;
+    Stats *stats;
+    uint8_t near;          /* TTLs budgeted per hop */
+    double interval;       /* seconds per probe of one budget */
+    double burst;          /* seconds a budget may run ahead */
+    double hop[UINT8_MAX + 1];  /* theoretical arrival times */
+    std::vector<double> prefix;
+    std::vector<held_probe_t> ring;
+    uint32_t head;         /* oldest held probe */
+    uint32_t tail;
+    uint32_t held;         /* used entries between head and tail */
+    double soonest;        /* no held probe is within budget before */
+};
+
+#endif
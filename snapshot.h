@@ -0,0 +1,47 @@
+/****************************************************************************
+   Program:     $Id: $
+   Date:        $Date: $
+   Description: helpers for mmap'able snapshots of compiled lookup tables
+****************************************************************************/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Sections start on a cache line, so mapped arrays are aligned */
+#define SNAP_ALIGN 64
+#define SNAP_MAGIC "YRPLPM3"
+
+typedef struct _snap_hdr_t {
+    char magic[8];
+    uint32_t family;
+    uint32_t pad;
+    uint64_t hash;     /* of the BGP table and blocklist read */
+    uint64_t count[4]; /* section lengths, in elements */
+} snap_hdr_t;
+
+static inline size_t snap_pad(size_t len) {
+    return (len + SNAP_ALIGN - 1) & ~(size_t)(SNAP_ALIGN - 1);
+}
+
+/* Write one section, padded to the alignment */
+static inline bool snap_write(FILE *f, const void *data, size_t len) {
+    static const char zero[SNAP_ALIGN] = {0};
+    if (len and fwrite(data, 1, len, f) != len)
+        return false;
+    len = snap_pad(len) - len;
+    return len == 0 or fwrite(zero, 1, len, f) == len;
+}
+
+/* Point at the next section of a mapped snapshot */
+static inline const void *snap_map(const char **p, const char *end, size_t len) {
+    const char *s = *p;
+    if (s + len > end)
+        return NULL;
+    *p += snap_pad(len);
+    return s;
+}
+
+#endif /* SNAPSHOT_H */
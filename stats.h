@@ -4,7 +4,10 @@ class Stats {
     public:
     Stats() : count(0), to_probe(0), nbr_skipped(0), bgp_skipped(0),
               ttl_outside(0), bgp_outside(0), adr_outside(0), baddst(0),
-              fills(0) {
+              fills(0), reload_blocked(0), reached_skipped(0),
+              stop_skipped(0), stop_checked(0), stop_missed(0), retried(0),
+              replies(0), drops(0), rate_backoffs(0), deferred(0),
+              asn_skipped(0), asnbudget(NULL), pipeline(NULL) {
       gettimeofday(&start, NULL);
     };
     void terse() {
@@ -20,6 +23,10 @@ class Stats {
       fprintf(out, " in: %2.1fs (%2.1f pps)\n",
         t, (float) count / t);
     };
+    /* Estimated new interfaces the stop set's skipped probes would have found */
+    uint64_t stop_loss() {
+      return stop_checked ? stop_skipped * stop_missed / stop_checked : 0;
+    };
     void dump(FILE *out) {
       gettimeofday(&end, NULL);
       float t = (float) tsdiff(&end, &start) / 1000.0;
@@ -35,6 +42,20 @@ class Stats {
       fprintf(out, "# Outside_Addr: %" PRId64 "\n", adr_outside);
       fprintf(out, "# Skipped_Nbr: %" PRId64 "\n", nbr_skipped);
       fprintf(out, "# Skipped_BGP: %" PRId64 "\n", bgp_skipped);
+      fprintf(out, "# Skipped_Reload: %" PRId64 "\n", reload_blocked);
+      fprintf(out, "# Skipped_Reached: %" PRId64 "\n", reached_skipped);
+      fprintf(out, "# Skipped_Stop: %" PRId64 "\n", stop_skipped);
+      fprintf(out, "# Skipped_ASN: %" PRId64 "\n", asn_skipped);
+      fprintf(out, "# Stop_Loss: %" PRId64 "\n", stop_loss());
+      fprintf(out, "# Retried: %" PRId64 "\n", retried);
+      fprintf(out, "# Replies: %" PRId64 "\n", replies);
+      fprintf(out, "# Kernel_Drops: %" PRId64 "\n", drops);
+      fprintf(out, "# Rate_Backoffs: %" PRId64 "\n", rate_backoffs);
+      fprintf(out, "# Deferred: %" PRId64 "\n", deferred);
+      if (asnbudget)
+        asnbudget->dump(out);
+      if (pipeline)
+        pipeline->dump(out);
       fprintf(out, "# Pkts: %" PRId64 "\n", count);
       fprintf(out, "# Elapsed: %2.2fs\n", t);
       fprintf(out, "# PPS: %2.2f\n", (float) count / t);
@@ -50,6 +71,19 @@ class Stats {
     uint64_t adr_outside; // b/c address outside range we want
     uint64_t baddst;      // b/c checksum invalid on destination in reponse
     uint64_t fills;       // extra tail probes past maxttl
+    uint64_t reload_blocked; // b/c added to blocklist during the scan
+    uint64_t reached_skipped; // b/c target answered at a lower TTL
+    uint64_t stop_skipped; // b/c path below a stop set interface is known
+    uint64_t stop_checked; // replies below a target's stop TTL
+    uint64_t stop_missed;  // ... that revealed a new interface
+    uint64_t retried;      // probes re-sent in retry passes
+    uint64_t replies;      // valid replies to this instance's probes
+    uint64_t drops;        // replies the kernel dropped before the listener
+    uint64_t rate_backoffs; // times rate control backed the rate off
+    uint64_t deferred;     // probes held back for a hop or prefix budget
+    uint64_t asn_skipped;  // b/c over the origin AS's rate or total cap
+    AsnBudget *asnbudget;  // per origin AS accounting, if capping
+    Pipeline *pipeline;    // per stage counters, if pipelined
    
     struct timeval start;
     struct timeval end;
@@ -1,35 +1,38 @@
 #ifndef _STATUS_H_
 #define _STATUS_H_
 
-#ifndef UINT8_MAX
- #define UINT8_MAX (255)
-#endif
+#include <stdint.h>
+#include <vector>
+
+/* TTLs past a prefix's horizon that are always probed */
+#define STATUS_GAP 2
+/* Probes past the gap, without the horizon moving, before giving up */
+#define STATUS_QUIET 8
 
-#include <unordered_set>
+/* State of one BGP prefix */
+typedef struct {
+    uint8_t high;   /* highest TTL at which a router answered */
+    uint8_t quiet;  /* probes past high + STATUS_GAP since high last rose */
+} prefix_status_t;
 
+/*
+ * Per-prefix probing state, kept in a flat array indexed by each BGP
+ * prefix's slot in the compiled lookup table.  The listener raises a
+ * prefix's horizon as routers answer; the sender stops probing TTLs beyond
+ * it once STATUS_QUIET probes there went unanswered, i.e. once the prefix's
+ * traces have ended.  Both update the state with atomics, without locks.
+ */
 class Status {
     public:
-    Status() : probes(0), returns(0), lastSent(0), lastReply(0), 
-               highTTL(1), lowTTL(UINT8_MAX)  
-    {
-        missingTTL.clear();
-    };
-    void print();
-    void reset();
-    void probed(uint8_t ttl, uint32_t elapsed);
-    void result(uint8_t ttl, uint32_t elapsed);
-    uint8_t getTTL() { return highTTL; }
-    bool shouldProbe();
+    Status(uint32_t prefixes) : state(prefixes) {};
+    bool shouldProbe(uint32_t prefix, uint8_t ttl);
+    void result(uint32_t prefix, uint8_t ttl);
+    uint8_t getTTL(uint32_t prefix) {
+        return __atomic_load_n(&state[prefix].high, __ATOMIC_RELAXED);
+    }
 
     private:
-    void printMissingTTL();
-    uint16_t probes;
-    uint16_t returns;
-    uint32_t lastSent;
-    uint32_t lastReply;
-    uint8_t highTTL;
-    uint8_t lowTTL;
-    std::unordered_set<uint8_t> missingTTL; 
+    std::vector<prefix_status_t> state;
 };
 
 #endif
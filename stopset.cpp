@@ -0,0 +1,70 @@
+/****************************************************************************
+   Program:     $Id: $
+   Date:        $Date: $
+   Description: yarrp stop set.  (Interface, destination prefix) pairs
+                already discovered; probes below them need not be sent.
+****************************************************************************/
+#include "yarrp.h"
+
+static inline uint64_t
+mix(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+StopSet::StopSet(bool ipv6, uint64_t targets) :
+    known(ipv6 ? REACHED_PERTARGET : REACHED_PER24, targets, true) {
+    if ((bits = (uint64_t *) calloc(1ULL << (STOPSET_BITS - 6), sizeof(uint64_t))) == NULL)
+        fatal("Cannot allocate stop set: %s", strerror(errno));
+}
+
+StopSet::~StopSet() {
+    free(bits);
+}
+
+/*
+ * Add a pair to the Bloom filter, returning whether it was (probably)
+ * already there.  Only the listener thread calls this.
+ */
+bool
+StopSet::learn(uint64_t key, uint8_t stop, uint8_t ttl, Stats *stats) {
+    uint64_t h = mix(key);
+    uint64_t step = (h >> 32) | 1;
+    bool seen = true;
+    for (int i = 0; i < STOPSET_HASHES; i++, h += step) {
+        uint64_t bit = h & ((1ULL << STOPSET_BITS) - 1);
+        if ((bits[bit >> 6] & (1ULL << (bit & 63))) == 0) {
+            bits[bit >> 6] |= 1ULL << (bit & 63);
+            seen = false;
+        }
+    }
+    /* A reply the stop set would have suppressed: was its hop new? */
+    if (ttl < stop) {
+        stats->stop_checked++;
+        if (not seen)
+            stats->stop_missed++;
+    }
+    return seen;
+}
+
+/*
+ * Router hop answered a probe to target sent with ttl
+ */
+void
+StopSet::result(uint32_t hop, uint32_t target, uint8_t ttl, Stats *stats) {
+    uint64_t prefix = ntohl(target) >> (32 - STOPSET_PREFIX4);
+    if (learn(((uint64_t) hop << 32) | prefix, known.ttl(target), ttl, stats))
+        known.add(target, ttl);
+}
+
+void
+StopSet::result(const struct in6_addr *hop, const struct in6_addr *target, uint8_t ttl, Stats *stats) {
+    struct in6_addr prefix;
+    memset(&prefix, 0, sizeof(struct in6_addr));
+    memcpy(&prefix, target, STOPSET_PREFIX6 / 8);
+    if (learn(Reached::hash(hop) ^ mix(Reached::hash(&prefix)), known.ttl(target), ttl, stats))
+        known.add(target, ttl);
+}
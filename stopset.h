@@ -0,0 +1,42 @@
+#ifndef _STOPSET_H_
+#define _STOPSET_H_
+
+#include <stdint.h>
+
+/* log2 of the stop set's Bloom filter, in bits (8 MB) */
+#define STOPSET_BITS 26
+/* Bits set per (interface, destination prefix) pair */
+#define STOPSET_HASHES 3
+/* Destination prefix lengths the pairs are keyed on */
+#define STOPSET_PREFIX4 16
+#define STOPSET_PREFIX6 32
+
+/*
+ * Doubletree-style stop set.  The listener records the (interface,
+ * destination prefix) pair of each time-exceeded reply in a Bloom filter.
+ * When a probe to a target reveals a pair already in the set, the path has
+ * converged onto a known interface, and the hops below it, between the
+ * vantage point and that interface, are taken to be known as well; the
+ * sender skips the target's lower TTLs.
+ *
+ * Replies to probes below a target's stop TTL (sent before it was learned)
+ * show how often those hops would still have been new, from which the
+ * discovery lost to the skipped probes is estimated.
+ */
+class StopSet {
+    public:
+    StopSet(bool ipv6, uint64_t targets);
+    ~StopSet();
+    void result(uint32_t hop, uint32_t target, uint8_t ttl, Stats *stats);
+    void result(const struct in6_addr *hop, const struct in6_addr *target, uint8_t ttl, Stats *stats);
+    /* TTL below which the target's path is known, or 0 */
+    uint8_t ttl(uint32_t target) { return known.ttl(target); }
+    uint8_t ttl(const struct in6_addr *target) { return known.ttl(target); }
+
+    private:
+    bool learn(uint64_t key, uint8_t stop, uint8_t ttl, Stats *stats);
+    uint64_t *bits;
+    Reached known;  /* highest TTL at which each target met the set */
+};
+
+#endif
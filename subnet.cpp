@@ -46,7 +46,10 @@ Subnet6::Subnet6(string s, uint8_t granularity) {
         if (smask > 64) {
             fatal("IPv6 prefix must be at least /64 or larger!");
         }
-        cnt = 1 << (granularity-m);
+        if (granularity < smask or granularity > 64 or granularity - smask >= 64) {
+            fatal("IPv6 granularity /%d must be between /%d and /64", granularity, smask);
+        }
+        cnt = (uint64_t)1 << (granularity-m);
 
         /* four 32-bits words in ipv6 address; which one is subnet boundary */
         uint8_t boundary_word = m / 32;
@@ -6,6 +6,9 @@ SubnetList::SubnetList(uint8_t _maxttl, uint8_t _gran) : maxttl(_maxttl), granul
     current_twentyfour = 0;
     current_48 = 0;
     current_ttl = 0;
+    current_pos = 0;
+    start_pos = 0;
+    end_pos = UINT64_MAX;
     ttlmask_bits = intlog(maxttl);
     ttlmask = (1 << ttlmask_bits) - 1;
 };
@@ -17,6 +20,8 @@ void
 SubnetList::add_subnet(string s, bool ipv6) {
     if (ipv6) {
         Subnet6 subnet = Subnet6(s, granularity);
+        if (subnet.count() > (UINT64_MAX - addr_count) / (maxttl + 1))
+            fatal("Too many targets at /%d granularity: %s", granularity, s.c_str());
         subnets6.push_back(subnet);
         current_subnet6 = subnets6.begin();
         addr_count += subnet.count() * maxttl;
@@ -26,11 +31,51 @@ SubnetList::add_subnet(string s, bool ipv6) {
         current_subnet = subnets.begin();
         addr_count += subnet.count() * maxttl;
     }
+    /* a list holds one family, so these stay in IPv4-then-IPv6 order */
+    offsets.push_back(addr_count);
+}
+
+/* Order the subnets by address, so index() can binary search them; once
+   all are added */
+void
+SubnetList::sort() {
+    starts.clear();
+    for (uint32_t i = 0; i < subnets.size(); i++)
+        starts.push_back(make_pair((uint64_t) (subnets[i].first() >> 8), i));
+    for (uint32_t i = 0; i < subnets6.size(); i++) {
+        struct in6_addr *f = subnets6[i].first();
+        starts.push_back(make_pair(((uint64_t) ntohl(f->s6_addr32[0]) << 32) | ntohl(f->s6_addr32[1]), i));
+    }
+    std::sort(starts.begin(), starts.end());
+}
+
+/* Read list of subnets, one per line; blank lines and #comments skipped */
+void
+SubnetList::read(char *in, bool ipv6) {
+    if (*in == '-') {
+        read(std::cin, ipv6);
+    } else {
+        std::ifstream ifile(in);
+        if (ifile.good() == false)
+            fatal("Bad subnet file: %s", in);
+        read(ifile, ipv6);
+    }
+}
+
+void
+SubnetList::read(std::istream& inlist, bool ipv6) {
+    std::string line;
+    while (getline(inlist, line)) {
+        line.erase(std::find(line.begin(), line.end(), '#'), line.end());
+        line.erase(std::remove_if(line.begin(), line.end(), ::isspace), line.end());
+        if (not line.empty())
+            add_subnet(line, ipv6);
+    }
 }
 
 uint32_t
 SubnetList::next_address(struct in6_addr *in, uint8_t * ttl) {
-    if (current_subnet6 == subnets6.end()) {
+    if (current_subnet6 == subnets6.end() or current_pos >= end_pos) {
         return 0;
     }
     *ttl = current_ttl;
@@ -38,16 +83,9 @@ SubnetList::next_address(struct in6_addr *in, uint8_t * ttl) {
     // don't muck w/ the iterator; copy 
     memcpy(in, current_subnet6->first(), sizeof(struct in6_addr));
 
-    /* since we're dividing in /48s:
-        - increment second word's high 16 bits by current_48
-        - only increment first word (32bits) if we overflow current_48 16 bits
-    */
-    int word0 = current_48 / 65536;
-    int word1 = current_48 % 65536;
-
-    (*in).s6_addr32[0] += htonl(word0);
-    (*in).s6_addr32[1] += htonl(word1<<16);
+    offset6(in, current_48);
     (*in).s6_addr32[3] += htonl(getHost(0));
+    current_pos++;
     /*
     char output[INET6_ADDRSTRLEN];
     inet_ntop(AF_INET6, in, output, INET6_ADDRSTRLEN); 
@@ -66,11 +104,12 @@ SubnetList::next_address(struct in6_addr *in, uint8_t * ttl) {
 
 uint32_t
 SubnetList::next_address(struct in_addr *in, uint8_t * ttl) {
-    if (current_subnet == subnets.end()) {
+    if (current_subnet == subnets.end() or current_pos >= end_pos) {
         return 0;
     }
     in->s_addr = htonl((*current_subnet).first() + (current_twentyfour << 8) + getHost(0));
     *ttl = current_ttl;
+    current_pos++;
     if (++current_ttl > maxttl) {
         current_ttl = 0;
         current_twentyfour += 1;
@@ -82,11 +121,137 @@ SubnetList::next_address(struct in_addr *in, uint8_t * ttl) {
     return 1;
 }
 
-uint32_t
+/* Number of addresses handed out so far */
+uint64_t
+SubnetList::position() {
+    return current_pos;
+}
+
+/* Restart the walk at pos addresses in: each unit is visited at ttls 0..maxttl */
+void
+SubnetList::seek(uint64_t pos) {
+    uint64_t unit = pos / (maxttl + 1);
+
+    current_pos = pos;
+    current_ttl = pos % (maxttl + 1);
+    current_twentyfour = current_48 = 0;
+    for (current_subnet = subnets.begin(); current_subnet != subnets.end(); current_subnet++) {
+        if (unit < current_subnet->count()) {
+            current_twentyfour = unit;
+            return;
+        }
+        unit -= current_subnet->count();
+    }
+    for (current_subnet6 = subnets6.begin(); current_subnet6 != subnets6.end(); current_subnet6++) {
+        if (unit < current_subnet6->count()) {
+            current_48 = unit;
+            return;
+        }
+        unit -= current_subnet6->count();
+    }
+}
+
+/* Restrict the walk to the k-th of n contiguous slices */
+void
+SubnetList::shard(uint32_t k, uint32_t n) {
+    /* the sequential walk visits ttls 0..maxttl of every unit */
+    uint64_t size = addr_count / maxttl * (maxttl + 1);
+    uint64_t start = size / n * k + min((uint64_t)k, size % n);
+
+    end_pos = start + size / n + (k < size % n ? 1 : 0);
+    debug(LOW, ">> Shard " << k << "/" << n << ": indices [" << start << ", " << end_pos << ")");
+    seek(start_pos = start);
+}
+
+/* Start the walk (or this slice of it) over; the sequential order is fixed */
+void
+SubnetList::rekey(uint32_t seed) {
+    seek(start_pos);
+}
+
+/* Unit of a target address, counting units across all subnets in order:
+   the subnet starting nearest below it, by binary search */
+bool
+SubnetList::index(uint32_t addr, uint64_t *unit) {
+    uint32_t net24 = ntohl(addr) >> 8;
+    vector<pair<uint64_t, uint32_t> >::iterator it;
+
+    it = upper_bound(starts.begin(), starts.end(), make_pair((uint64_t) net24, (uint32_t) UINT32_MAX));
+    if (it != starts.begin()) {
+        --it;
+        if (net24 - it->first < subnets[it->second].count()) {
+            *unit = base(it->second) + (net24 - it->first);
+            return true;
+        }
+    }
+    /* the nearest may be nested in, or lie beyond, a subnet holding it */
+    return scan(addr, unit);
+}
+
+bool
+SubnetList::index(const struct in6_addr *addr, uint64_t *unit) {
+    uint64_t high = ((uint64_t) ntohl(addr->s6_addr32[0]) << 32) | ntohl(addr->s6_addr32[1]);
+    vector<pair<uint64_t, uint32_t> >::iterator it;
+    uint64_t offset;
+
+    it = upper_bound(starts.begin(), starts.end(), make_pair(high, (uint32_t) UINT32_MAX));
+    if (it != starts.begin()) {
+        --it;
+        offset = (high - it->first) >> (64 - granularity);
+        if (offset < subnets6[it->second].count()) {
+            *unit = base(subnets.size() + it->second) + offset;
+            return true;
+        }
+    }
+    return scan(addr, unit);
+}
+
+/* Subnets in list order, for addresses of overlapping subnets */
+bool
+SubnetList::scan(uint32_t addr, uint64_t *unit) {
+    uint32_t net24 = ntohl(addr) >> 8;
+
+    for (uint32_t i = 0; i < subnets.size(); i++) {
+        uint32_t first = subnets[i].first() >> 8;
+        if (net24 >= first and net24 - first < subnets[i].count()) {
+            *unit = base(i) + (net24 - first);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+SubnetList::scan(const struct in6_addr *addr, uint64_t *unit) {
+    uint64_t high = ((uint64_t) ntohl(addr->s6_addr32[0]) << 32) | ntohl(addr->s6_addr32[1]);
+
+    for (uint32_t i = 0; i < subnets6.size(); i++) {
+        struct in6_addr *f = subnets6[i].first();
+        uint64_t first = ((uint64_t) ntohl(f->s6_addr32[0]) << 32) | ntohl(f->s6_addr32[1]);
+        uint64_t offset = (high - first) >> (64 - granularity);
+        if (high >= first and offset < subnets6[i].count()) {
+            *unit = base(subnets.size() + i) + offset;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t
 SubnetList::count() {
     return addr_count;
 }
 
+/* Add offset, in units of the probing granularity, to the top 64 bits of in */
+void
+SubnetList::offset6(struct in6_addr *in, uint64_t offset) {
+    uint64_t high = ((uint64_t) ntohl(in->s6_addr32[0]) << 32) | ntohl(in->s6_addr32[1]);
+
+    high += offset << (64 - granularity);
+    in->s6_addr32[0] = htonl(high >> 32);
+    in->s6_addr32[1] = htonl(high & 0xFFFFFFFF);
+}
+
 uint16_t        
 SubnetList::getHost(uint8_t * addr) {
     return 1;
@@ -8,7 +8,8 @@
 #define SUBNET_LIST_H
 #include <stdint.h>
 #include <string>
-#include <list>
+#include <vector>
+#include <istream>
 
 #include "subnet.h"
 
@@ -19,27 +20,45 @@ class SubnetList {
         SubnetList(uint8_t maxttl, uint8_t gran);
         virtual ~SubnetList();
         virtual void add_subnet(string s, bool ipv6);
+        void read(char *in, bool ipv6);
         virtual uint32_t next_address(struct in_addr *in, uint8_t *ttl);
         virtual uint32_t next_address(struct in6_addr *in, uint8_t *ttl);
-        uint32_t count();
+        virtual uint64_t position();
+        virtual void seek(uint64_t pos);
+        virtual void shard(uint32_t k, uint32_t n);
+        virtual void rekey(uint32_t seed);
+        void sort();
+        bool index(uint32_t addr, uint64_t *unit);
+        bool index(const struct in6_addr *addr, uint64_t *unit);
+        uint64_t count();
 
     protected:
-        list<Subnet> subnets;
-        list<Subnet6> subnets6;
-        uint32_t addr_count;
+        vector<Subnet> subnets;
+        vector<Subnet6> subnets6;
+        uint64_t addr_count;
         uint8_t maxttl;
         uint8_t granularity;
         uint32_t ttlmask_bits;
         uint32_t ttlmask;
+        vector<uint64_t> offsets;  /* end of each subnet's pairs: IPv4, then IPv6 */
+        vector<pair<uint64_t, uint32_t> > starts;  /* (first unit, subnet), by address */
 
         uint16_t getHost(uint8_t *addr);
+        void offset6(struct in6_addr *in, uint64_t offset);
+        uint64_t base(uint32_t i) { return i ? offsets[i - 1] / maxttl : 0; }
+        bool scan(uint32_t addr, uint64_t *unit);
+        bool scan(const struct in6_addr *addr, uint64_t *unit);
 
     private:
-        list<Subnet>::iterator current_subnet;
-        list<Subnet6>::iterator current_subnet6;
+        void read(std::istream& in, bool ipv6);
+        vector<Subnet>::iterator current_subnet;
+        vector<Subnet6>::iterator current_subnet6;
         uint32_t current_twentyfour; 
-        uint32_t current_48; 
+        uint64_t current_48; 
         uint8_t current_ttl; 
+        uint64_t current_pos;
+        uint64_t start_pos;
+        uint64_t end_pos;
 };
 
 #endif /* SUBNET_LIST_H */
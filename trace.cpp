@@ -5,7 +5,7 @@
 ****************************************************************************/
 #include "yarrp.h"
 
-Traceroute::Traceroute(YarrpConfig *_config, Stats *_stats) : config(_config), stats(_stats), tree(NULL), recv_thread()
+Traceroute::Traceroute(YarrpConfig *_config, Stats *_stats) : config(_config), stats(_stats), tree(NULL), status(NULL), asnbudget(NULL), ttldist(NULL), pipeline(NULL), bench(NULL), reached(NULL), stopset(NULL), retry(NULL), ratectl(NULL), sched(NULL), recv_thread()
 {
     dstport = config->dstport;
     if (config->ttl_neighborhood)
@@ -24,7 +24,8 @@ Traceroute::~Traceroute() {
     gettimeofday(&start, NULL);
     debug(HIGH, ">> Traceroute engine stopped: " << start.tv_sec);
     fflush(NULL);
-    pthread_cancel(recv_thread);
+    if (config->probe and config->receive)
+        pthread_cancel(recv_thread);
     if (config->out)
         fclose(config->out);
 }
@@ -24,6 +24,40 @@ class Traceroute {
     void addStats(Stats *_stats) {
         stats = _stats;
     }
+    void addStatus(Status *_status) {
+        status = _status;
+    }
+    void addAsnBudget(AsnBudget *_asnbudget) {
+        asnbudget = _asnbudget;
+    }
+    void addTTLDist(TTLDist *_ttldist) {
+        ttldist = _ttldist;
+    }
+    void addPipeline(Pipeline *_pipeline) {
+        pipeline = _pipeline;
+    }
+    void addBench(Bench *_bench) {
+        bench = _bench;
+    }
+    void addReached(Reached *_reached) {
+        reached = _reached;
+    }
+    void addStopSet(StopSet *_stopset) {
+        stopset = _stopset;
+    }
+    void addRetry(Retry *_retry) {
+        retry = _retry;
+    }
+    void addRateControl(RateControl *_ratectl) {
+        ratectl = _ratectl;
+    }
+    void addScheduler(Scheduler *_sched) {
+        sched = _sched;
+    }
+    /* sending threads stamp probes relative to the main engine's clock */
+    void share(Traceroute *_trace) {
+        start = _trace->start;
+    }
     void initHisto(uint8_t);
     void dumpHisto();
     uint32_t elapsed();
@@ -37,6 +71,16 @@ class Traceroute {
 
     public:
     Patricia *tree;
+    Status *status;  /* per-prefix state, indexed via tree */
+    AsnBudget *asnbudget;  /* per origin AS caps, indexed via tree */
+    TTLDist *ttldist;  /* per-TTL probing probabilities */
+    Pipeline *pipeline;  /* generator and filter stage rings */
+    Bench *bench;      /* null sink and stage timing, in place of the socket */
+    Reached *reached;  /* TTL at which each target answered */
+    StopSet *stopset;  /* interfaces known per destination prefix */
+    Retry *retry;      /* answered probes, for retry passes */
+    RateControl *ratectl;  /* reply-driven rate control */
+    Scheduler *sched;  /* per-hop and per-prefix budgets, this sender's */
     Stats *stats;
     YarrpConfig *config;
     vector<TTLHisto *> ttlhisto;
@@ -66,6 +110,7 @@ class Traceroute4 : public Traceroute {
     void probeUDP(struct sockaddr_in *, int);
     void probeTCP(struct sockaddr_in *, int);
     void probeICMP(struct sockaddr_in *, int);
+    ssize_t transmit(struct sockaddr_in *);
     struct ip *outip;
     struct sockaddr_in source;
     char addrstr[INET_ADDRSTRLEN];
@@ -7,13 +7,18 @@
 
 Traceroute4::Traceroute4(YarrpConfig *_config, Stats *_stats) : Traceroute(_config, _stats)
 {
-    if (config->testing) return;
+    outip = NULL;
+    if (config->testing and not config->bench) return;
     memset(&source, 0, sizeof(struct sockaddr_in)); 
     if (config->probesrc) {
         source.sin_family = AF_INET;
         if (inet_pton(AF_INET, config->probesrc, &source.sin_addr) != 1)
           fatal("** Bad source address.");
         cout << ">> Using IP source: " << config->probesrc << endl;
+    } else if (config->bench) {
+        /* benchmark packets never leave the process */
+        source.sin_family = AF_INET;
+        source.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
     } else {
         infer_my_ip(&source);
     }
@@ -24,7 +29,7 @@ Traceroute4::Traceroute4(YarrpConfig *_config, Stats *_stats) : Traceroute(_conf
     outip->ip_v = IPVERSION;
     outip->ip_hl = sizeof(struct ip) >> 2;
     outip->ip_src.s_addr = source.sin_addr.s_addr;
-    sndsock = raw_sock(&source);
+    sndsock = config->bench ? -1 : raw_sock(&source);
     if (config->probe and config->receive) {
         lock();   /* grab mutex; make listener thread block. */
         pthread_create(&recv_thread, NULL, listener, this);
@@ -38,14 +43,20 @@ Traceroute4::~Traceroute4() {
 
 void Traceroute4::probePrint(struct in_addr *targ, int ttl) {
     uint32_t diff = elapsed();
+    /* one write per line; sending threads share stdout */
+    ostringstream line;
+    char targstr[INET_ADDRSTRLEN];
+    /* as given: in -T mode the constructor never fills addrstr */
     if (config->probesrc)
-        cout << inet_ntoa(source.sin_addr) << " -> ";
-    cout << inet_ntoa(*targ) << " ttl: ";
-    cout << ttl;
+        line << config->probesrc << " -> ";
+    inet_ntop(AF_INET, targ, targstr, INET_ADDRSTRLEN);
+    line << targstr << " ttl: ";
+    line << ttl;
     if (config->instance)
-        cout << " i=" << (int) config->instance;
-    cout << " t=" << diff;
-    (config->coarse) ? cout << "ms" << endl : cout << "us" << endl;
+        line << " i=" << (int) config->instance;
+    line << " t=" << diff;
+    (config->coarse) ? line << "ms" << endl : line << "us" << endl;
+    cout << line.str();
 }
 
 void
@@ -91,6 +102,14 @@ Traceroute4::probe(struct sockaddr_in *target, int ttl) {
     }
 }
 
+/* Send the built packet, or hand it to the benchmark's sink */
+ssize_t
+Traceroute4::transmit(struct sockaddr_in *target) {
+    if (bench)
+        return bench->sink(outip, packlen);
+    return sendto(sndsock, (char *)outip, packlen, 0, (struct sockaddr *)target, sizeof(*target));
+}
+
 void
 Traceroute4::probeUDP(struct sockaddr_in *target, int ttl) {
     unsigned char *ptr = (unsigned char *)outip;
@@ -140,7 +159,7 @@ Traceroute4::probeUDP(struct sockaddr_in *target, int ttl) {
         crafted_cksum = 0xFFFF;
     udp->uh_sum = crafted_cksum;
 
-    if (sendto(sndsock, (char *)outip, packlen, 0, (struct sockaddr *)target, sizeof(*target)) < 0) {
+    if (transmit(target) < 0) {
         cout << __func__ << "(): error: " << strerror(errno) << endl;
         cout << ">> UDP probe: " << inet_ntoa(target->sin_addr) << " ttl: ";
         cout << ttl << " t=" << diff << endl;
@@ -192,7 +211,7 @@ Traceroute4::probeTCP(struct sockaddr_in *target, int ttl) {
      */
     u_short len = sizeof(struct tcphdr) + payloadlen;
     tcp->th_sum = p_cksum(outip, (u_short *) tcp, len);
-    if (sendto(sndsock, (char *)outip, packlen, 0, (struct sockaddr *)target, sizeof(*target)) < 0) {
+    if (transmit(target) < 0) {
         cout << __func__ << "(): error: " << strerror(errno) << endl;
         cout << ">> TCP probe: " << inet_ntoa(target->sin_addr) << " ttl: ";
         cout << ttl << " t=" << diff << endl;
@@ -244,7 +263,7 @@ Traceroute4::probeICMP(struct sockaddr_in *target, int ttl) {
         crafted_cksum = 0xFFFF;
     icmp->icmp_cksum = crafted_cksum;
 
-    if (sendto(sndsock, (char *)outip, packlen, 0, (struct sockaddr *)target, sizeof(*target)) < 0) {
+    if (transmit(target) < 0) {
         cout << __func__ << "(): error: " << strerror(errno) << endl;
         cout << ">> ICMP probe: " << inet_ntoa(target->sin_addr) << " ttl: ";
         cout << ttl << " t=" << diff << endl;
@@ -6,36 +6,46 @@
 #include "yarrp.h"
 
 Traceroute6::Traceroute6(YarrpConfig *_config, Stats *_stats) : Traceroute(_config, _stats) {
-    if (config->testing) return;
+    if (config->testing and not config->bench) return;
     memset(&source6, 0, sizeof(struct sockaddr_in6));
     if (config->probesrc) {
         source6.sin6_family = AF_INET6;
         if (inet_pton(AF_INET6, config->probesrc, &source6.sin6_addr) != 1)
           fatal("** Bad source address."); 
+    } else if (config->bench) {
+        /* benchmark packets never leave the process */
+        source6.sin6_family = AF_INET6;
+        source6.sin6_addr = in6addr_loopback;
     } else {
         infer_my_ip6(&source6);
     }
     inet_ntop(AF_INET6, &source6.sin6_addr, addrstr, INET6_ADDRSTRLEN);
     config->set("SourceIP", addrstr, true);
+    if (config->bench) {
+        sndsock = -1;
+    } else {
 #ifdef _LINUX
-    sndsock = raw_sock6(&source6);
+        sndsock = raw_sock6(&source6);
 #else
-    /* Init BPF socket */
-    sndsock = bpfget();
-    if (sndsock < 0) fatal("bpf open error\n");
-    struct ifreq bound_if;
-    strcpy(bound_if.ifr_name, config->int_name);
-    if (ioctl(sndsock, BIOCSETIF, &bound_if) > 0) fatal("ioctl err\n");
+        /* Init BPF socket */
+        sndsock = bpfget();
+        if (sndsock < 0) fatal("bpf open error\n");
+        struct ifreq bound_if;
+        strcpy(bound_if.ifr_name, config->int_name);
+        if (ioctl(sndsock, BIOCSETIF, &bound_if) > 0) fatal("ioctl err\n");
 #endif
+    }
     pcount = 0;
 
     assert(config);
-    assert(config->srcmac);
+    assert(config->srcmac or config->bench);
 
-    /* Set Ethernet header */
+    /* Set Ethernet header; benchmarks without MACs leave them zero */
     frame = (uint8_t *)calloc(1, PKTSIZE);
-    memcpy (frame, config->dstmac, 6 * sizeof (uint8_t));
-    memcpy (frame + 6, config->srcmac, 6 * sizeof (uint8_t));
+    if (config->dstmac)
+        memcpy (frame, config->dstmac, 6 * sizeof (uint8_t));
+    if (config->srcmac)
+        memcpy (frame + 6, config->srcmac, 6 * sizeof (uint8_t));
     frame[12] = 0x86; /* IPv6 Ethertype */
     frame[13] = 0xdd;
 
@@ -57,23 +67,31 @@ Traceroute6::Traceroute6(YarrpConfig *_config, Stats *_stats) : Traceroute(_conf
 }
 
 Traceroute6::~Traceroute6() {
-    if (config->testing) return;
+    if (config->testing and not config->bench) return;
     free(frame);
 }
 
 void Traceroute6::probePrint(struct in6_addr addr, int ttl) {
     uint32_t diff = elapsed();
-    if (config->probesrc) {
-        inet_ntop(AF_INET6, &source6.sin6_addr, addrstr, INET6_ADDRSTRLEN);
-        cout << addrstr << " -> ";
-    }
-    inet_ntop(AF_INET6, &addr, addrstr, INET6_ADDRSTRLEN);
-    cout << addrstr << " ttl: " << ttl << " t=" << diff;
-    (config->coarse) ? cout << "ms" << endl : cout << "us" << endl;
+    /* one write per line; sending threads share stdout */
+    ostringstream line;
+    char targstr[INET6_ADDRSTRLEN];
+    /* as given: in -T mode the constructor never fills source6 */
+    if (config->probesrc)
+        line << config->probesrc << " -> ";
+    inet_ntop(AF_INET6, &addr, targstr, INET6_ADDRSTRLEN);
+    line << targstr << " ttl: " << ttl << " t=" << diff;
+    (config->coarse) ? line << "ms" << endl : line << "us" << endl;
+    cout << line.str();
 }
 
 void
 Traceroute6::probe(struct in6_addr addr, int ttl) {
+    /* the benchmark's sink needs no link-layer destination */
+    if (bench) {
+        probe(NULL, addr, ttl);
+        return;
+    }
 #ifdef _LINUX 
     struct sockaddr_ll target;
     memset(&target, 0, sizeof(target));
@@ -147,6 +165,11 @@ Traceroute6::probe(void *target, struct in6_addr addr, int ttl) {
       probePrint(addr, ttl);
     }
     uint16_t framelen = ETH_HDRLEN + sizeof(ip6_hdr) + ext_hdr_len + packlen;
+    if (bench) {
+        bench->sink(frame, framelen);
+        pcount++;
+        return;
+    }
 #ifdef _LINUX
     if (sendto(sndsock, frame, framelen, 0, (struct sockaddr *)target,
         sizeof(struct sockaddr_ll)) < 0)
@@ -0,0 +1,74 @@
+/****************************************************************************
+   Program:     $Id: $
+   Date:        $Date: $
+   Description: yarrp TTL distribution.  Per-TTL acceptance thresholds for
+                Poisson, uniform or empirical TTL sampling.
+****************************************************************************/
+#include "yarrp.h"
+
+TTLDist::TTLDist(YarrpConfig *config) : key(config->seed * 0x9e3779b9) {
+    const char *spec = config->ttldist;
+    double lambda;
+    char *end;
+
+    for (int i = 0; i <= UINT8_MAX; i++)
+        thresh[i] = 1ULL << 32;
+    if (spec == NULL) {
+        poisson(config->poisson);
+    } else if (strncmp(spec, "poisson:", 8) == 0) {
+        lambda = strtod(spec + 8, &end);
+        if (*end != '\0' or lambda <= 0)
+            fatal("Bad TTL distribution %s: expected poisson:lambda, lambda > 0", spec);
+        poisson(lambda);
+    } else if (strcmp(spec, "uniform") != 0) {
+        empirical(spec);
+    }
+    for (int i = config->minttl; i <= config->maxttl; i++)
+        debug(HIGH, ">> TTL " << i << " probability: " << (double) thresh[i] / (1ULL << 32));
+}
+
+/* Probe each TTL with its Poisson pmf */
+void
+TTLDist::poisson(double lambda) {
+    for (int i = 0; i <= UINT8_MAX; i++)
+        thresh[i] = poisson_pmf(i, lambda) * (1ULL << 32);
+}
+
+/*
+ * TTL weights from a file of "ttl weight" lines, or from a .yrp output
+ * (target sec usec type code ttl hop ...), counting replies at each TTL
+ * from routers other than the target itself
+ */
+void
+TTLDist::empirical(const char *filename) {
+    double weight[UINT8_MAX + 1];
+    double w, top = 0;
+    char line[1024];
+    char target[INET6_ADDRSTRLEN];
+    char hop[INET6_ADDRSTRLEN];
+    unsigned int ttl;
+    FILE *f = fopen(filename, "r");
+
+    if (f == NULL)
+        fatal("%s: cannot open %s: %s", __func__, filename, strerror(errno));
+    for (int i = 0; i <= UINT8_MAX; i++)
+        weight[i] = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#')
+            continue;
+        if (sscanf(line, "%45s %*u %*u %*u %*u %u %45s", target, &ttl, hop) == 3) {
+            if (ttl <= UINT8_MAX and strcmp(target, hop) != 0)
+                weight[ttl]++;
+        } else if (sscanf(line, "%u %lf", &ttl, &w) == 2) {
+            if (ttl <= UINT8_MAX and w > 0)
+                weight[ttl] += w;
+        }
+    }
+    fclose(f);
+    for (int i = 0; i <= UINT8_MAX; i++)
+        top = max(top, weight[i]);
+    if (top == 0)
+        fatal("No TTL weights in %s", filename);
+    for (int i = 0; i <= UINT8_MAX; i++)
+        thresh[i] = weight[i] / top * (1ULL << 32);
+}
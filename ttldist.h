@@ -0,0 +1,47 @@
+#ifndef _TTLDIST_H_
+#define _TTLDIST_H_
+
+#include <stdint.h>
+
+/*
+ * TTL sampling distribution.  The permutation still visits every (target,
+ * TTL) pair; each is probed with its TTL's probability, precomputed as a
+ * 32-bit fixed point acceptance threshold.  A probe's coin is a hash of
+ * the target, TTL and seed, so deciding costs a multiply-xor hash and one
+ * integer compare, and repeated passes (retries, threads, resumed scans)
+ * agree on which probes the distribution keeps.
+ *
+ * Distributions: poisson:lambda (the probability is the pmf itself, as
+ * -Z always did), uniform (every TTL), or an empirical one read from a
+ * file of "ttl weight" lines or from a previous scan's .yrp output, where
+ * each TTL is weighted by the replies from routers other than the target.
+ * Empirical weights are scaled so the most common TTL is always probed.
+ */
+class TTLDist {
+    public:
+    TTLDist(YarrpConfig *config);
+    bool accept(uint32_t target, uint8_t ttl) {
+        return coin(target, ttl) < thresh[ttl];
+    }
+    bool accept(const struct in6_addr *target, uint8_t ttl) {
+        return coin(target->s6_addr32[0] ^ target->s6_addr32[1] ^
+                    target->s6_addr32[2] ^ target->s6_addr32[3], ttl) < thresh[ttl];
+    }
+
+    private:
+    uint64_t coin(uint32_t target, uint8_t ttl) {
+        uint32_t h = target ^ key ^ ((uint32_t) ttl << 24);
+        h ^= h >> 16;
+        h *= 0x85ebca6b;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35;
+        h ^= h >> 16;
+        return h;
+    }
+    void poisson(double lambda);
+    void empirical(const char *filename);
+    uint32_t key;
+    uint64_t thresh[UINT8_MAX + 1];  /* probability * 2^32, per TTL */
+};
+
+#endif
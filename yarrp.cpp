@@ -13,18 +13,280 @@
 #include "yarrp.h"
 
 
+/* Probes held back for their budget that are now within it; with wait,
+   at least one, unless none are held */
+static void
+held(YarrpConfig * config, Scheduler * sched, batch_t * b, bool wait) {
+    struct in_addr target;
+    uint8_t ttl;
+
+    while (b->n < LOOKUP_BATCH) {
+        if (config->ipv6) {
+            if (not sched->release(&b->addr6[b->n], &ttl, wait and b->n == 0))
+                break;
+        } else {
+            if (not sched->release(&target.s_addr, &ttl, wait and b->n == 0))
+                break;
+            b->addr[b->n] = target.s_addr;
+        }
+        b->held[b->n] = true;
+        b->ttl[b->n++] = ttl;
+    }
+}
+
+/* Fill the batch with (target, TTL) pairs drawn from the permutation that
+   pass the checks needing no lookup */
 template < class TYPE >
 void
-loop(YarrpConfig * config, TYPE * iplist, Traceroute * trace,
-     Patricia * tree, Stats * stats) {
+generate(YarrpConfig * config, TYPE * iplist, Traceroute * trace, Stats * stats,
+         bool positions, bool * exhausted, batch_t * b) {
     struct in_addr target;
     struct in6_addr target6;
     uint8_t ttl;
     TTLHisto *ttlhisto = NULL;
-    Status *status = NULL;
+    Retry *retry = trace->retry;
+    TTLDist *ttldist = trace->ttldist;
+    bool retrying = retry and retry->pass() > 0;
+
+    while (b->n < LOOKUP_BATCH) {
+        /* Grab next target/ttl pair from permutation */
+        if (config->ipv6) {
+            if ((iplist->next_address(&target6, &ttl)) == 0) {
+                *exhausted = true;
+                break;
+            }
+        } else {
+            if ((iplist->next_address(&target, &ttl)) == 0) {
+                *exhausted = true;
+                break;
+            }
+        }
+        /* TTL control enforcement */
+        ttl += config->minttl;
+        if (ttl > config->maxttl) {
+            continue;
+        }
+        /* Retry passes re-send only the probes that drew no reply */
+        if (retrying) {
+            if (not (config->ipv6 ? retry->pending(&target6, ttl) : retry->pending(target.s_addr, ttl)))
+                continue;
+        }
+        /* Running w/ a biased TTL probability distribution */
+        if (ttldist) {
+            if (not (config->ipv6 ? ttldist->accept(&target6, ttl) : ttldist->accept(target.s_addr, ttl)))
+                continue;
+        }
+        /* Send probe only if outside discovered neighborhood */
+        if (ttl < config->ttl_neighborhood) {
+            ttlhisto = trace->ttlhisto[ttl];
+            if (ttlhisto->shouldProbeProb() == false) {
+                //cout << "TTL Skip: " << inet_ntoa(target) << " TTL: " << (int)ttl << endl;
+                stats->nbr_skipped++;
+                continue;
+            }
+            ttlhisto->probed(trace->elapsed());
+        }
+        if (config->ipv6)
+            b->addr6[b->n] = target6;
+        else
+            b->addr[b->n] = target.s_addr;
+        if (positions)
+            b->pos[b->n] = iplist->position();
+        b->held[b->n] = false;
+        b->ttl[b->n++] = ttl;
+    }
+    b->last = *exhausted;
+}
+
+/* Look the batch up in the current BGP/blocklist table, as far as needed */
+static void
+lookup(YarrpConfig * config, Traceroute * trace, Reload * reload, uint32_t reader, batch_t * b) {
+    Patricia *tree = trace->tree;
+    /* Entire mode only generates routed, unblocked targets */
+    bool filter = (config->bgpfile or config->blocklist) and not config->entire;
+
+    b->table = tree;
+    /* Pick up a reloaded blocklist; entire mode must then check it too */
+    if (reload)
+        b->table = reload->acquire(reader);
+    b->filter = filter or b->table != tree;
+    if (b->filter or trace->status or trace->asnbudget or (trace->sched and config->bgpfile)) {
+        if (config->ipv6)
+            b->table->get(b->addr6, b->n, b->asn);
+        else
+            b->table->get(b->addr, b->n, b->asn);
+    }
+}
+
+/* Only send probe if destination is in BGP table, and not blocked */
+static bool
+routed(YarrpConfig * config, Patricia * tree, Stats * stats, batch_t * b, int i) {
     char ptarg[INET6_ADDRSTRLEN];
-    double prob, flip;
+    int *asn = b->asn[i];
+    int *was;
+
+    if (verbosity >= HIGH) {
+        if (config->ipv6)
+            inet_ntop(AF_INET6, &b->addr6[i], ptarg, INET6_ADDRSTRLEN);
+        else
+            inet_ntop(AF_INET, &b->addr[i], ptarg, INET6_ADDRSTRLEN);
+    }
+    if (asn == NULL) {
+        debug(DEBUG, "BGP Skip: " << ptarg << " TTL: " << (int)b->ttl[i]);
+        stats->bgp_outside++;
+        return false;
+    }
+    if (*asn == 0) {
+        debug(HIGH, ">> Address in blocklist: " << ptarg << " TTL: " << (int)b->ttl[i]);
+        /* Count probes only a reload has blocked */
+        if (b->table != tree) {
+            was = (int *) (config->ipv6 ? tree->get(b->addr6[i]) : tree->get(b->addr[i]));
+            if (was == NULL or *was != 0)
+                stats->reload_blocked++;
+        }
+        return false;
+    }
+    debug(DEBUG, ">> Prefix: " << ptarg << " ASN: " << *asn);
+    return true;
+}
+
+/* Pipeline stage threads' arguments */
+template < class TYPE >
+struct Stage {
+    YarrpConfig *config;
+    TYPE *iplist;
+    Traceroute *trace;
+    Reload *reload;
+    Stats *stats;
+    bool positions;
+};
+
+/* Generator stage: batches drawn from the permutation */
+template < class TYPE >
+void *
+generator(void *arg) {
+    Stage < TYPE > *s = (Stage < TYPE > *) arg;
+    Pipeline *pipe = s->trace->pipeline;
+    double start = now();
+    bool exhausted = false;
+    batch_t *b;
+
+    while (not exhausted) {
+        while ((b = pipe->generated.claim()) == NULL) {
+            if (pipe->stopping())
+                goto out;
+            pipe->stall(&pipe->gen);
+        }
+        b->n = 0;
+        generate(s->config, s->iplist, s->trace, s->stats, s->positions, &exhausted, b);
+        pipe->gen.batches++;
+        pipe->gen.idle = 0;
+        pipe->gen.pairs += b->n;
+        pipe->generated.publish();
+    }
+  out:
+    pipe->gen.time += now() - start;
+    return NULL;
+}
+
+/* Filter stage: drops unrouted and blocked targets.  Lookup results are
+   handed on from the scan's own table, which reloads never free. */
+template < class TYPE >
+void *
+filterer(void *arg) {
+    Stage < TYPE > *s = (Stage < TYPE > *) arg;
+    YarrpConfig *config = s->config;
+    Patricia *tree = s->trace->tree;
+    Pipeline *pipe = s->trace->pipeline;
+    double start = now();
+    uint32_t reader = 0;
+    bool last = false;
+    batch_t *in, *out;
+    int i;
+
+    if (s->reload)
+        reader = s->reload->join();
+    while (not last) {
+        while ((in = pipe->generated.peek()) == NULL) {
+            if (pipe->stopping())
+                goto out;
+            pipe->stall(&pipe->filt);
+        }
+        pipe->filt.occupancy += pipe->generated.size();
+        while ((out = pipe->filtered.claim()) == NULL) {
+            if (pipe->stopping())
+                goto out;
+            pipe->stall(&pipe->filt);
+        }
+        lookup(config, s->trace, s->reload, reader, in);
+        out->n = 0;
+        for (i = 0; i < in->n; i++) {
+            if (in->filter and not routed(config, tree, s->stats, in, i))
+                continue;
+            if (config->ipv6)
+                out->addr6[out->n] = in->addr6[i];
+            else
+                out->addr[out->n] = in->addr[i];
+            out->ttl[out->n] = in->ttl[i];
+            out->pos[out->n] = in->pos[i];
+            out->held[out->n] = false;
+            if (in->table == tree)
+                out->asn[out->n] = in->asn[i];
+            else
+                out->asn[out->n] = (int *) (config->ipv6 ? tree->get(in->addr6[i]) : tree->get(in->addr[i]));
+            out->n++;
+        }
+        out->table = tree;
+        out->filter = false;
+        out->last = last = in->last;
+        pipe->filt.batches++;
+        pipe->filt.idle = 0;
+        pipe->filt.pairs += out->n;
+        pipe->generated.consume();
+        pipe->filtered.publish();
+    }
+  out:
+    if (s->reload)
+        s->reload->leave(reader);
+    pipe->filt.time += now() - start;
+    return NULL;
+}
+
+template < class TYPE >
+void
+loop(YarrpConfig * config, TYPE * iplist, Traceroute * trace,
+     Patricia * tree, Reload * reload, Stats * stats, Checkpoint * checkpoint) {
+    struct in_addr target;
+    struct in6_addr target6;
+    uint8_t ttl;
+    /* Targets are drawn and BGP/blocklist-filtered LOOKUP_BATCH at a time */
+    batch_t local;
+    batch_t *b;
+    int i;
+    uint64_t position = 0;
+    bool done = false;
+    bool exhausted = false;
+    Status *status = trace->status;
+    Reached *reached = trace->reached;
+    uint8_t reached_ttl;
+    StopSet *stopset = trace->stopset;
+    Retry *retry = trace->retry;
+    RateControl *ratectl = trace->ratectl;
+    Scheduler *sched = trace->sched;
+    AsnBudget *asnbudget = trace->asnbudget;
+    Pipeline *pipe = trace->pipeline;
+    Bench *bench = trace->bench;
+    uint64_t mark = 0;
+    Stage < TYPE > stage;
+    pthread_t gen_thread, filt_thread;
+    double start = now();
+    uint64_t batch_start;
+    bool retrying = retry and retry->pass() > 0;
     int *asn;
+    uint32_t reader = 0;
+
+    if (reload)
+        reader = reload->join();
 
     //adaptive timing to hit target rate
     uint64_t count = 0;
@@ -55,131 +317,249 @@ loop(YarrpConfig * config, TYPE * iplist, Traceroute * trace,
     }
 
     stats->to_probe = iplist->count();
-    while (true) {
-        /* Grab next target/ttl pair from permutation */
-        if (config->ipv6) {
-            if ((iplist->next_address(&target6, &ttl)) == 0)
-                break;
-        } else {
-            if ((iplist->next_address(&target, &ttl)) == 0)
-                break;
-        }
-        /* TTL control enforcement */
-        ttl += config->minttl;
-        if (ttl > config->maxttl) {
-            continue;
-        }
-        /* Running w/ a biased TTL probability distribution */
-        if (config->poisson) {
-            prob = poisson_pmf(ttl, config->poisson);
-            flip = zrand();
-            //cout << "TTL: " << (int)ttl << " PMF: " << prob << " flip: " << flip << endl;
-            if (flip > prob)
-                continue;
+    /* Generator and filter stages run ahead on their own threads */
+    if (pipe) {
+        stage.config = config;
+        stage.iplist = iplist;
+        stage.trace = trace;
+        stage.reload = reload;
+        stage.stats = stats;
+        stage.positions = checkpoint != NULL;
+        pipe->start();
+        pthread_create(&gen_thread, NULL, generator < TYPE >, &stage);
+        pthread_create(&filt_thread, NULL, filterer < TYPE >, &stage);
+    }
+    while (not done) {
+        b = &local;
+        b->n = 0;
+        if (bench)
+            mark = Bench::clock();
+        /* Probes held back for their budget go out once within it */
+        if (sched)
+            held(config, sched, b, exhausted);
+        if (not pipe) {
+            if (not exhausted)
+                generate(config, iplist, trace, stats, checkpoint != NULL, &exhausted, b);
+        } else if (b->n == 0 and not exhausted) {
+            b = pipe->next();
         }
-        /* Send probe only if outside discovered neighborhood */
-        if (ttl < config->ttl_neighborhood) {
-            ttlhisto = trace->ttlhisto[ttl];
-            if (ttlhisto->shouldProbeProb() == false) {
-                //cout << "TTL Skip: " << inet_ntoa(target) << " TTL: " << (int)ttl << endl;
-                stats->nbr_skipped++;
+        if (bench)
+            mark = bench->lap(&bench->gen, b->n, mark);
+        if (b == &local)
+            lookup(config, trace, reload, reader, b);
+        if (bench)
+            mark = bench->lap(&bench->filt, b->n, mark);
+        batch_start = stats->count;
+        for (i = 0; i < b->n; i++) {
+            ttl = b->ttl[i];
+            if (config->ipv6)
+                target6 = b->addr6[i];
+            else
+                target.s_addr = b->addr[i];
+            if (b->filter and not routed(config, tree, stats, b, i))
                 continue;
+            /* Skip TTLs past where this prefix's traces have ended */
+            if (status) {
+                if (b->table == tree)
+                    asn = b->asn[i];
+                else
+                    asn = (int *) (config->ipv6 ? tree->get(target6) : tree->get(target.s_addr));
+                if (asn and not status->shouldProbe(tree->prefix(asn), ttl)) {
+                    stats->bgp_skipped++;
+                    continue;
+                }
             }
-            ttlhisto->probed(trace->elapsed());
-        }
-        /* Only send probe if destination is in BGP table */
-        if (config->bgpfile or config->blocklist) {
-            if (config->ipv6) {
-                asn = (int *)tree->get(target6);
-            } else {
-                asn = (int *)tree->get(target.s_addr);
-            }
-            if (verbosity >= HIGH)
-                inet_ntop(AF_INET, &target, ptarg, INET6_ADDRSTRLEN);
-            if (asn == NULL) {
-                debug(DEBUG, "BGP Skip: " << ptarg << " TTL: " << (int)ttl);
-                stats->bgp_outside++;
-                continue;
+            /* Skip TTLs past where the target itself has answered */
+            if (reached) {
+                reached_ttl = config->ipv6 ? reached->ttl(&target6) : reached->ttl(target.s_addr);
+                if (reached_ttl and ttl > reached_ttl) {
+                    stats->reached_skipped++;
+                    continue;
+                }
             }
-            if (*asn == 0) {
-                debug(HIGH, ">> Address in blocklist: " << ptarg << " TTL: " << (int)ttl);
-                continue;
-            } else {
-                debug(DEBUG, ">> Prefix: " << ptarg << " ASN: " << *asn);
+            /* Skip TTLs below a hop already discovered for the prefix */
+            if (stopset) {
+                if (ttl < (config->ipv6 ? stopset->ttl(&target6) : stopset->ttl(target.s_addr))) {
+                    stats->stop_skipped++;
+                    continue;
+                }
             }
-#if 0
-                status = (Status *) tree->get(target.s_addr);
-                if (status) {
-                    status->probed(ttl, trace->elapsed());
-                } else {
-                    stats->bgp_outside++;
+            /* Skip probes over their origin AS's caps */
+            if (asnbudget and not b->held[i]) {
+                if (b->table == tree)
+                    asn = b->asn[i];
+                else
+                    asn = (int *) (config->ipv6 ? tree->get(target6) : tree->get(target.s_addr));
+                if (asn and not asnbudget->charge(tree->prefix(asn), (uint32_t) now())) {
+                    stats->asn_skipped++;
                     continue;
                 }
-#endif
-        }
-        /* Passed all checks, continue and send probe */
-        if (not config->testing) {
-            if (config->ipv6)
-                trace->probe(target6, ttl);
-            else
-                trace->probe(target.s_addr, ttl);
-        } else if (verbosity > HIGH) {
-            if (config->ipv6)
-                trace->probePrint(target6, ttl);
-            else
-                trace->probePrint(&target, ttl);
-        }
-        stats->count++;
-        /* Progress printer */
-        if ((verbosity >= LOW) and
-            (iplist->count() > 10000) and
-            (stats->count % (iplist->count() / 1000) == 0)) {
-            stats->terse();
-        }
+            }
+            /* Hold back probes over their hop's or prefix's budget */
+            if (sched and not b->held[i]) {
+                asn = config->bgpfile ? b->asn[i] : NULL;
+                if (not (config->ipv6 ? sched->admit(&target6, ttl, asn) : sched->admit(target.s_addr, ttl, asn)))
+                    continue;
+            }
+            /* Passed all checks, continue and send probe */
+            if (bench) {
+                if (config->ipv6)
+                    bench->queued.addr6[bench->queued.n] = target6;
+                else
+                    bench->queued.addr[bench->queued.n] = target.s_addr;
+                bench->queued.ttl[bench->queued.n++] = ttl;
+            } else if (not config->testing) {
+                if (config->ipv6)
+                    trace->probe(target6, ttl);
+                else
+                    trace->probe(target.s_addr, ttl);
+            } else if (verbosity > HIGH) {
+                if (config->ipv6)
+                    trace->probePrint(target6, ttl);
+                else
+                    trace->probePrint(&target, ttl);
+            }
+            stats->count++;
+            if (retrying)
+                stats->retried++;
+            /* Record scan position for --resume */
+            if (checkpoint) {
+                position = b->pos[i];
+                if ((stats->count & CHECKPOINT_MASK) == 0)
+                    checkpoint->periodic(position, iplist->count(), stats);
+            }
+            /* Progress printer */
+            if ((verbosity >= LOW) and
+                (iplist->count() > 10000) and
+                (stats->count % (iplist->count() / 1000) == 0)) {
+                stats->terse();
+            }
 
-        /* Calculate sleep time based on scan rate */
-        if (config->rate) {
-            send_rate = (double)config->rate;
-            if (count && delay > 0) {
-                if (send_rate < slow_rate) {
-                    double t = now();
-                    double last_rate = (1.0 / (t - last_time));
-
-                    sleep_time *= ((last_rate / send_rate) + 1) / 2;
-                    ts.tv_sec = sleep_time / nsec_per_sec;
-                    ts.tv_nsec = sleep_time % nsec_per_sec;
-                    while (nanosleep(&ts, &rem) == -1) {
-                    }
-                    last_time = t;
-                } else {
-                    for (vi = delay; vi--;);
-                    if (!interval || (count % interval == 0)) {
+            /* Calculate sleep time based on scan rate */
+            if (config->rate) {
+                send_rate = (double)config->rate;
+                if (ratectl)
+                    send_rate *= ratectl->scale();
+                if (count && delay > 0) {
+                    if (send_rate < slow_rate) {
                         double t = now();
-                        double multiplier =
-                        (double)(count - last_count) /
-                        (t - last_time) /
-                        (config->rate);
-                        uint32_t old_delay = delay;
-                        delay *= multiplier;
-                        if (delay == old_delay) {
-                            if (multiplier > 1.0) {
-                                delay *= 2;
-                            } else if (multiplier < 1.0) {
-                                delay *= 0.5;
-                            }
+                        double last_rate = (1.0 / (t - last_time));
+
+                        sleep_time *= ((last_rate / send_rate) + 1) / 2;
+                        ts.tv_sec = sleep_time / nsec_per_sec;
+                        ts.tv_nsec = sleep_time % nsec_per_sec;
+                        while (nanosleep(&ts, &rem) == -1) {
                         }
-                        last_count = count;
                         last_time = t;
+                    } else {
+                        for (vi = delay; vi--;);
+                        if (!interval || (count % interval == 0)) {
+                            double t = now();
+                            double multiplier =
+                            (double)(count - last_count) /
+                            (t - last_time) /
+                            send_rate;
+                            uint32_t old_delay = delay;
+                            delay *= multiplier;
+                            if (delay == old_delay) {
+                                if (multiplier > 1.0) {
+                                    delay *= 2;
+                                } else if (multiplier < 1.0) {
+                                    delay *= 0.5;
+                                }
+                            }
+                            last_count = count;
+                            last_time = t;
+                        }
                     }
                 }
             }
+            count = stats->count;
+
+            /* Quit if we've exceeded probe count from command line */
+            if (stats->count == config->count) {
+                done = true;
+                break;
+            }
+        }
+        /* Build the batch's probes into the benchmark's sink */
+        if (bench) {
+            mark = bench->lap(&bench->check, b->n, mark);
+            for (i = 0; i < bench->queued.n; i++) {
+                if (config->ipv6)
+                    trace->probe(bench->queued.addr6[i], bench->queued.ttl[i]);
+                else
+                    trace->probe(bench->queued.addr[i], bench->queued.ttl[i]);
+            }
+            bench->lap(&bench->build, bench->queued.n, mark);
+            bench->queued.n = 0;
+        }
+        /* Feed the batch to the reply-driven rate control */
+        if (ratectl) {
+            ratectl->sent(stats->count - batch_start);
+            ratectl->tick();
+        }
+        if (b != &local) {
+            exhausted = b->last;
+            pipe->done(b);
         }
-        count = stats->count;
+        /* Done once the permutation and held probes are both used up */
+        if (exhausted and (not sched or sched->empty()))
+            done = true;
+    }
+    if (pipe) {
+        pipe->stop();
+        pthread_join(gen_thread, NULL);
+        pthread_join(filt_thread, NULL);
+        pipe->send.time += now() - start;
+    }
+    if (reload)
+        reload->leave(reader);
+    /* The permutation may have been drawn past the last probe sent */
+    if (checkpoint)
+        checkpoint->save((config->count and stats->count == config->count) ? position : iplist->position(),
+                         iplist->count(), stats);
+}
 
-        /* Quit if we've exceeded probe count from command line */
-        if (stats->count == config->count)
-            break;
+/* Write the pairs the scan would probe, in order, to a schedule file */
+template < class TYPE >
+void
+compile(YarrpConfig * config, TYPE * iplist, Traceroute * trace, Stats * stats, ScheduleWriter * out) {
+    batch_t b;
+    bool exhausted = false;
+    int i;
+
+    while (not exhausted) {
+        b.n = 0;
+        generate(config, iplist, trace, stats, false, &exhausted, &b);
+        lookup(config, trace, NULL, 0, &b);
+        for (i = 0; i < b.n; i++) {
+            if (b.filter and not routed(config, trace->tree, stats, &b, i))
+                continue;
+            if (config->ipv6)
+                out->add(&b.addr6[i], b.ttl[i]);
+            else
+                out->add(b.addr[i], b.ttl[i]);
+        }
     }
+    out->finish();
+}
+
+/* Additional entire mode sending thread, probing its own slice */
+struct Sender {
+    YarrpConfig config;
+    IPList *iplist;
+    Traceroute *trace;
+    Reload *reload;
+    Stats stats;
+    pthread_t thread;
+};
+
+void *
+sender(void *arg) {
+    Sender *s = (Sender *) arg;
+    loop(&s->config, s->iplist, s->trace, s->trace->tree, s->reload, &s->stats, (Checkpoint *) NULL);
+    return NULL;
 }
 
 int
@@ -196,8 +576,70 @@ sane(YarrpConfig * config) {
     }
     if (config->entire and not config->bgpfile)
         fatal("Entire Internet mode requires BGP table");
-    if (config->inlist and config->entire)
+    if ((config->inlist or config->subnetfile) and config->entire)
         fatal("Cannot run in entire Internet mode with input targets");
+    if (config->inlist and config->subnetfile)
+        fatal("Cannot use both input targets and input subnets");
+    if (config->resume and not config->checkpoint)
+        fatal("Resume requires a checkpoint file");
+    if (config->horizon and not config->bgpfile)
+        fatal("Prefix horizons require a BGP table");
+    if (config->poisson and config->ttldist)
+        fatal("Cannot use both Poisson TTLs and a TTL distribution");
+    if ((config->asn_rate or config->asn_max) and not config->bgpfile)
+        fatal("Per-AS caps require a BGP table");
+    if (config->adaptive and not config->rate)
+        fatal("Adaptive rate requires a rate to adapt");
+    /* Shards are slices of one permutation (entire mode always permutes);
+       a resumed scan takes the checkpoint's seed, and a schedule is
+       already in order */
+    if (config->shard_n > 1 and (config->random_scan or config->entire) and
+        not config->seeded and not config->resume and not config->schedule)
+        fatal("Shards require a common seed (-S) on every instance");
+    if (config->retries and config->checkpoint)
+        fatal("Cannot checkpoint a scan with retries");
+    if (config->budget and config->checkpoint)
+        fatal("Cannot checkpoint a scan with hop budgets");
+    if (config->bench) {
+        if (config->compile)
+            fatal("Cannot benchmark a schedule compile");
+        if (config->pipeline)
+            fatal("Cannot benchmark a pipelined scan");
+        if (config->threads > 1)
+            fatal("Cannot benchmark multiple sending threads");
+    }
+    if (config->compile) {
+        if (config->schedule)
+            fatal("Cannot compile a schedule from a schedule");
+        if (config->ttl_neighborhood)
+            fatal("Cannot compile a schedule with neighborhood TTL");
+        if (config->threads > 1)
+            fatal("Cannot compile a schedule with multiple sending threads");
+    }
+    if (config->schedule) {
+        if (config->inlist or config->subnetfile or config->entire)
+            fatal("Cannot use a schedule with input targets");
+        if (config->retries)
+            fatal("Cannot retry a schedule");
+    }
+    if (config->threads > 1) {
+        if (not config->entire)
+            fatal("Multiple sending threads require entire Internet mode");
+        if (config->checkpoint)
+            fatal("Cannot checkpoint with multiple sending threads");
+        if (config->ttl_neighborhood)
+            fatal("Cannot use neighborhood TTL with multiple sending threads");
+        if (config->retries)
+            fatal("Cannot retry with multiple sending threads");
+        if (config->pipeline)
+            fatal("Cannot pipeline multiple sending threads");
+        if (config->rate and config->rate < config->threads)
+            fatal("Rate must be at least the number of threads");
+        if (config->budget and config->budget < config->threads)
+            fatal("Hop budget must be at least the number of threads");
+        if (config->count and config->count < config->threads)
+            fatal("Probe count must be at least the number of threads");
+    }
     return true;
 }
 
@@ -211,7 +653,7 @@ main(int argc, char **argv) {
     sane(&config);
 
     /* Ensure we're the only Yarrp probing instance on this machine */
-    if (config.probe)
+    if (config.probe and not config.compile and not config.bench)
         instanceLock(config.instance);
 
     /* Setup IPv6, if using (must be done before trace object) */
@@ -229,6 +671,21 @@ main(int argc, char **argv) {
             }
         }
     }
+    /* Play back a compiled schedule, already in order and filtered; it
+       sets the TTL range a resumed checkpoint must match */
+    Schedule *schedule = NULL;
+    if (config.schedule and config.probe) {
+        if (optind < argc)
+            fatal("Cannot use a schedule with input targets");
+        schedule = new Schedule(&config);
+    }
+    /* Pick up seed and position of an interrupted scan */
+    Checkpoint *checkpoint = NULL;
+    if (config.checkpoint and config.probe) {
+        checkpoint = new Checkpoint(&config);
+        if (config.resume)
+            checkpoint->load();
+    }
     /* Init target list (individual IPs, *NOT* subnets) from input file */
     IPList *iplist = NULL;
     if (config.inlist or config.entire) {
@@ -243,20 +700,41 @@ main(int argc, char **argv) {
     }
     /* Initialize subnet list and add subnets from args */
     SubnetList *subnetlist = NULL;
-    if (not config.entire and not config.inlist and config.probe) {
+    if (not config.entire and not config.inlist and not config.schedule and config.probe) {
         if (config.random_scan)
             subnetlist = new RandomSubnetList(config.maxttl, config.granularity);
         else
             subnetlist = new SubnetList(config.maxttl, config.granularity);
         for (int i = optind; i < argc; i++)
             subnetlist->add_subnet(argv[i], config.ipv6);
+        if (config.subnetfile)
+            subnetlist->read(config.subnetfile, config.ipv6);
         if (0 == subnetlist->count())
             config.usage(argv[0]);
+        subnetlist->sort();
     }
     /* Initialize radix trie, if using */
-    Patricia *tree = NULL;
-    if (config.ipv6) {
-        tree = new Patricia(128);
+    Patricia *tree = new Patricia(config.ipv6 ? 128 : 32);
+    /* Per-probe routed, blocklist and prefix horizon checks use a flattened trie */
+    bool flatten = (config.bgpfile or config.blocklist) and config.probe and
+                   (not config.entire or config.horizon or config.budget or
+                    config.asn_rate or config.asn_max);
+    bool mapped = false;
+    uint64_t hash = 0;
+    char snapfile[PATH_MAX];
+    if (flatten and config.tablecache) {
+        hash = Patricia::fingerprint(config.ipv6 ? AF_INET6 : AF_INET, config.bgpfile, config.blocklist);
+        snprintf(snapfile, sizeof(snapfile), "%s/table%d-%016" PRIx64 ".snap",
+                 config.tablecache, config.ipv6 ? 6 : 4, hash);
+        mapped = tree->load(snapfile, hash);
+        if (mapped)
+            debug(LOW, ">> Mapped compiled lookup table: " << snapfile);
+    }
+    /* Entire mode still permutes over the trie's routes, so populate it
+       under a mapped table too */
+    if (mapped and not config.entire) {
+        /* tables from an earlier run on the same inputs */
+    } else if (config.ipv6) {
         if (config.blocklist) {
             debug(LOW, ">> Populating IPv6 blocklist: " << config.blocklist);
             tree->populateBlock(AF_INET6, config.blocklist);
@@ -268,19 +746,29 @@ main(int argc, char **argv) {
             tree->add(AF_INET6, "::/0", 1);
         }
     } else {
-        tree = new Patricia(32);
         if (config.blocklist) {
             debug(LOW, ">> Populating IPv4 blocklist: " << config.blocklist);
             tree->populateBlock(AF_INET, config.blocklist);
         }
         if (config.bgpfile) {
                 debug(LOW, ">> Populating IPv4 trie from: " << config.bgpfile);
-            //tree->populateStatus(config.bgpfile);
             tree->populate(config.bgpfile);
         } else {
             tree->add("0.0.0.0/0", 1);
         }
     }
+    if (flatten and not mapped) {
+        tree->compile();
+        if (config.tablecache and not tree->save(snapfile, hash))
+            warn("Cannot save compiled lookup table %s: %s", snapfile, strerror(errno));
+    }
+    /* Entire mode permutes over the routed /24s (IPv4) or /48s (IPv6) */
+    if (config.entire)
+        iplist->routed(tree);
+    /* Rebuild the table on SIGHUP, so blocklist additions apply mid-scan */
+    Reload *reload = NULL;
+    if (config.blocklist and config.probe)
+        reload = new Reload(&config, tree);
     /* Initialize traceroute engine, if not in test mode */
     Stats *stats = new Stats();
     Traceroute *trace = NULL;
@@ -290,6 +778,151 @@ main(int argc, char **argv) {
         trace = new Traceroute4(&config, stats);
 
     trace->addTree(tree);
+    /* Per-prefix TTL horizons, one slot per prefix of the compiled table */
+    Status *status = NULL;
+    if (config.horizon and config.probe) {
+        status = new Status(tree->prefixes());
+        trace->addStatus(status);
+    }
+    /* Per origin AS probe caps, by the compiled table's prefix slots */
+    AsnBudget *asnbudget = NULL;
+    if ((config.asn_rate or config.asn_max) and config.probe) {
+        asnbudget = new AsnBudget(tree, config.asn_rate, config.asn_max);
+        trace->addAsnBudget(asnbudget);
+        stats->asnbudget = asnbudget;
+    }
+    /* Per-TTL probabilities of -Z or --ttl-dist */
+    TTLDist *ttldist = NULL;
+    if ((config.poisson or config.ttldist) and config.probe) {
+        ttldist = new TTLDist(&config);
+        trace->addTTLDist(ttldist);
+    }
+    /* Generator and filter stages on their own threads */
+    Pipeline *pipeline = NULL;
+    if (config.pipeline and config.probe) {
+        pipeline = new Pipeline();
+        trace->addPipeline(pipeline);
+        stats->pipeline = pipeline;
+    }
+    /* (target, TTL) pairs the scan draws */
+    uint64_t pairs = 0;
+    if (config.probe)
+        pairs = iplist ? iplist->count() : subnetlist ? subnetlist->count() : schedule->count();
+    /* Null sink and per-stage timing in place of sending */
+    Bench *bench = NULL;
+    if (config.bench and config.probe) {
+        bench = new Bench();
+        trace->addBench(bench);
+    }
+    /* Lowest TTL at which each target answered; per /24 where that is
+       the unit probed, else per target */
+    Reached *reached = NULL;
+    if (config.reached and config.probe) {
+        reached = new Reached(not config.ipv6 and (config.entire or subnetlist) ?
+                              REACHED_PER24 : REACHED_PERTARGET, pairs / config.maxttl);
+        trace->addReached(reached);
+    }
+    /* Doubletree-style stop set */
+    StopSet *stopset = NULL;
+    if (config.stopset and config.probe) {
+        stopset = new StopSet(config.ipv6, pairs / config.maxttl);
+        trace->addStopSet(stopset);
+    }
+    /* Answered probes, so retry passes re-send only the rest */
+    Retry *retry = NULL;
+    if (config.retries and config.probe) {
+        if (config.inlist)
+            iplist->reverse();
+        retry = new Retry(&config, iplist, subnetlist);
+        trace->addRetry(retry);
+    }
+    /* Without replies to go by, probe at the configured rate */
+    RateControl *ratectl = NULL;
+    if (config.adaptive and config.probe and config.receive) {
+        ratectl = new RateControl(config.rate, stats);
+        trace->addRateControl(ratectl);
+    }
+
+    /* Split the rate, count and this instance's slice among sending threads */
+    vector<Sender *> senders;
+    for (uint32_t t = 1; t < config.threads; t++) {
+        Sender *s = new Sender();
+        s->config = config;
+        s->config.receive = false;
+        s->config.out = NULL;
+        s->config.rate = config.rate / config.threads;
+        s->config.count = config.count / config.threads;
+        s->config.budget = config.budget / config.threads;
+        if (config.ipv6) {
+            s->iplist = new IPList6(config.maxttl, config.random_scan, config.entire);
+            s->trace = new Traceroute6(&s->config, &s->stats);
+        } else {
+            s->iplist = new IPList4(config.maxttl, config.random_scan, config.entire);
+            s->trace = new Traceroute4(&s->config, &s->stats);
+        }
+        s->iplist->setkey(config.seed);
+        s->iplist->share(iplist);
+        s->iplist->shard(config.shard_k, config.shard_n, t, config.threads);
+        s->trace->addTree(tree);
+        s->trace->addStatus(status);
+        s->trace->addAsnBudget(asnbudget);
+        s->trace->addTTLDist(ttldist);
+        s->trace->addReached(reached);
+        s->trace->addStopSet(stopset);
+        s->trace->addRateControl(ratectl);
+        if (config.budget)
+            s->trace->addScheduler(new Scheduler(&s->config, &s->stats));
+        s->trace->share(trace);
+        s->reload = reload;
+        senders.push_back(s);
+    }
+    if (config.threads > 1) {
+        config.rate -= config.rate / config.threads * (config.threads - 1);
+        config.count -= config.count / config.threads * (config.threads - 1);
+        config.budget -= config.budget / config.threads * (config.threads - 1);
+    }
+    /* Per-hop and per-prefix budgets, each sender holding to its share */
+    Scheduler *sched = NULL;
+    if (config.budget and config.probe) {
+        sched = new Scheduler(&config, stats);
+        trace->addScheduler(sched);
+    }
+    /* Restrict this instance to its slice of the permutation */
+    if (config.shard_n > 1 or config.threads > 1) {
+        if (iplist)
+            iplist->shard(config.shard_k, config.shard_n, 0, config.threads);
+        else if (subnetlist)
+            subnetlist->shard(config.shard_k, config.shard_n);
+        else if (schedule)
+            schedule->shard(config.shard_k, config.shard_n);
+    }
+    /* Continue the permutation where the checkpointed run stopped */
+    if (checkpoint and config.resume) {
+        checkpoint->restore(stats);
+        if (iplist) {
+            checkpoint->verify(iplist->count());
+            iplist->seek(checkpoint->position);
+        } else if (subnetlist) {
+            checkpoint->verify(subnetlist->count());
+            subnetlist->seek(checkpoint->position);
+        } else {
+            checkpoint->verify(schedule->count());
+            schedule->seek(checkpoint->position);
+        }
+    }
+    /* Compile the scan to a schedule in place of probing it */
+    if (config.compile) {
+        ScheduleWriter *writer = new ScheduleWriter(&config,
+            Patricia::fingerprint(config.ipv6 ? AF_INET6 : AF_INET, config.bgpfile, config.blocklist));
+        if (iplist)
+            compile(&config, iplist, trace, stats, writer);
+        else
+            compile(&config, subnetlist, trace, stats, writer);
+        debug(LOW, ">> Compiled " << writer->pairs() << " pairs in " << writer->blocks()
+              << " blocks (" << writer->size() << " bytes) to " << config.compile);
+        delete writer;
+        config.probe = false;
+    }
 
     /* Open output */
     if (config.receive) {
@@ -306,14 +939,54 @@ main(int argc, char **argv) {
     }
     if (config.probe) {
         debug(LOW, ">> Probing begins.");
+        if (reload)
+            reload->start();
         if (config.entire or config.inlist) {
             /* individual IPs from input file or entire mode */
-            loop(&config, iplist, trace, tree, stats);
+            for (uint32_t t = 0; t < senders.size(); t++)
+                pthread_create(&senders[t]->thread, NULL, sender, senders[t]);
+            loop(&config, iplist, trace, tree, reload, stats, checkpoint);
+            for (uint32_t t = 0; t < senders.size(); t++) {
+                pthread_join(senders[t]->thread, NULL);
+                stats->count += senders[t]->stats.count;
+                stats->nbr_skipped += senders[t]->stats.nbr_skipped;
+                stats->bgp_outside += senders[t]->stats.bgp_outside;
+                stats->reload_blocked += senders[t]->stats.reload_blocked;
+                stats->bgp_skipped += senders[t]->stats.bgp_skipped;
+                stats->reached_skipped += senders[t]->stats.reached_skipped;
+                stats->stop_skipped += senders[t]->stats.stop_skipped;
+                stats->deferred += senders[t]->stats.deferred;
+                stats->asn_skipped += senders[t]->stats.asn_skipped;
+            }
+        } else if (schedule) {
+            /* compiled schedule */
+            loop(&config, schedule, trace, tree, reload, stats, checkpoint);
         } else {
             /* using subnets from args */
-            loop(&config, subnetlist, trace, tree, stats);
+            loop(&config, subnetlist, trace, tree, reload, stats, checkpoint);
         }
+        /* Re-send the probes that drew no reply, in a fresh order */
+        for (int pass = 1; retry and pass <= config.retries; pass++) {
+            if (config.count and stats->count >= config.count)
+                break;
+            if (config.receive) {
+                debug(LOW, ">> Waiting " << RETRY_WAIT << "s before retry pass " << pass);
+                sleep(RETRY_WAIT);
+            }
+            retry->next(trace->elapsed());
+            if (iplist) {
+                iplist->rekey(config.seed + pass);
+                loop(&config, iplist, trace, tree, reload, stats, checkpoint);
+            } else {
+                subnetlist->rekey(config.seed + pass);
+                loop(&config, subnetlist, trace, tree, reload, stats, checkpoint);
+            }
+        }
+        if (reload)
+            reload->stop();
     }
+    if (bench)
+        bench->dump(stdout);
     if (config.receive) {
         debug(LOW, ">> Waiting " << SHUTDOWN_WAIT << "s for outstanding replies...");
         sleep(SHUTDOWN_WAIT);
@@ -325,12 +998,45 @@ main(int argc, char **argv) {
         else
             stats->dump(stdout);
     }
+    for (uint32_t t = 0; t < senders.size(); t++) {
+        if (senders[t]->trace->sched)
+            delete senders[t]->trace->sched;
+        delete senders[t]->trace;
+        delete senders[t]->iplist;
+        delete senders[t];
+    }
+    if (reload)
+        delete reload;
     delete stats;
     delete trace;
+    if (status)
+        delete status;
+    if (asnbudget)
+        delete asnbudget;
+    if (ttldist)
+        delete ttldist;
+    if (pipeline)
+        delete pipeline;
+    if (bench)
+        delete bench;
+    if (reached)
+        delete reached;
+    if (stopset)
+        delete stopset;
+    if (retry)
+        delete retry;
+    if (ratectl)
+        delete ratectl;
+    if (sched)
+        delete sched;
     if (tree)
         delete tree;
     if (iplist)
         delete iplist;
     if (subnetlist)
         delete subnetlist;
+    if (schedule)
+        delete schedule;
+    if (checkpoint)
+        delete checkpoint;
 }
@@ -62,6 +62,7 @@
 #include <sys/time.h>
 #include <time.h>
 #include <errno.h>
+#include <limits.h>
 #include <fcntl.h>
 #include <getopt.h>
 
@@ -95,6 +96,8 @@ extern int verbosity;
 #define SHUTDOWN_WAIT 60
 //#define SHUTDOWN_WAIT 300
 #define KEYLEN 16
+#define MAX_THREADS 64
+#define LOOKUP_BATCH 32  /* targets per batched BGP/blocklist lookup */
 #ifndef UINT8_MAX
  #define UINT8_MAX (255)
  #define UINT16_MAX (65535)
@@ -138,18 +141,28 @@ int bpfget();
 
 #include "yconfig.h"
 #include "patricia.h"
+#include "routed.h"
 #include "mac.h"
+#include "asnbudget.h"
+#include "pipeline.h"
+#include "bench.h"
 #include "stats.h"
+#include "checkpoint.h"
+#include "reload.h"
 #include "status.h"
+#include "reached.h"
+#include "stopset.h"
+#include "retry.h"
+#include "ratecontrol.h"
+#include "scheduler.h"
+#include "schedule.h"
 #include "ttlhisto.h"
+#include "ttldist.h"
 #include "subnet_list.h"
 #include "random_list.h"
 #include "trace.h"
 #include "icmp.h"
 
-void internet(YarrpConfig *config, Traceroute *trace, Patricia *tree, Stats *stats);
-void internet6(YarrpConfig *config, Traceroute *trace, Patricia *tree, Stats *stats);
-
 using namespace std;
 
 #endif  /* _YRP_H_ */
@@ -6,6 +6,29 @@
 #include "yarrp.h"
 int verbosity;
 
+/* long-only options */
+enum {
+    OPT_CHECKPOINT = 256,
+    OPT_RESUME,
+    OPT_SHARD,
+    OPT_THREADS,
+    OPT_SUBNETS,
+    OPT_TABLECACHE,
+    OPT_HORIZON,
+    OPT_REACHED,
+    OPT_STOPSET,
+    OPT_RETRIES,
+    OPT_ADAPTIVE,
+    OPT_BUDGET,
+    OPT_ASNRATE,
+    OPT_ASNMAX,
+    OPT_TTLDIST,
+    OPT_PIPELINE,
+    OPT_COMPILE,
+    OPT_SCHEDULE,
+    OPT_BENCH,
+};
+
 static struct option long_options[] = {
     {"srcaddr", required_argument, NULL, 'a'},
     {"bgp", required_argument, NULL, 'b'},
@@ -37,6 +60,25 @@ static struct option long_options[] = {
     {"granularity", required_argument, NULL, 'g'},
     {"v6eh", required_argument, NULL, 'X'}, 
     {"version", no_argument, NULL, 'V'}, 
+    {"checkpoint", required_argument, NULL, OPT_CHECKPOINT},
+    {"resume", no_argument, NULL, OPT_RESUME},
+    {"shard", required_argument, NULL, OPT_SHARD},
+    {"threads", required_argument, NULL, OPT_THREADS},
+    {"subnets", required_argument, NULL, OPT_SUBNETS},
+    {"table-cache", required_argument, NULL, OPT_TABLECACHE},
+    {"horizon", no_argument, NULL, OPT_HORIZON},
+    {"reached", no_argument, NULL, OPT_REACHED},
+    {"stopset", no_argument, NULL, OPT_STOPSET},
+    {"retries", required_argument, NULL, OPT_RETRIES},
+    {"adaptive-rate", no_argument, NULL, OPT_ADAPTIVE},
+    {"hop-budget", required_argument, NULL, OPT_BUDGET},
+    {"asn-rate", required_argument, NULL, OPT_ASNRATE},
+    {"asn-max", required_argument, NULL, OPT_ASNMAX},
+    {"ttl-dist", required_argument, NULL, OPT_TTLDIST},
+    {"pipeline", no_argument, NULL, OPT_PIPELINE},
+    {"compile-schedule", required_argument, NULL, OPT_COMPILE},
+    {"schedule", required_argument, NULL, OPT_SCHEDULE},
+    {"bench", no_argument, NULL, OPT_BENCH},
     {NULL, 0, NULL, 0},
 };
 
@@ -51,6 +93,7 @@ uint8_t *read_mac(char *str) {
 void
 YarrpConfig::parse_opts(int argc, char **argv) {
     int c, opt_index;
+    long n;
     char *endptr;
 
     if (argc <= 1)
@@ -99,6 +142,7 @@ YarrpConfig::parse_opts(int argc, char **argv) {
             break;
         case 'S':
             seed = strtol(optarg, &endptr, 10);
+            seeded = true;
             break;
         case 'T':
             testing = true;
@@ -188,13 +232,115 @@ YarrpConfig::parse_opts(int argc, char **argv) {
         case 'X':
             v6_eh = strtol(optarg, &endptr, 10);
             break;
+        case OPT_CHECKPOINT:
+            checkpoint = optarg;
+            params["Checkpoint"] = val_t(checkpoint, true);
+            break;
+        case OPT_RESUME:
+            resume = true;
+            break;
+        case OPT_SHARD:
+            if (sscanf(optarg, "%u/%u", &shard_k, &shard_n) != 2 or
+                shard_n == 0 or shard_k >= shard_n)
+                fatal("Bad shard %s: expected k/n with 0 <= k < n", optarg);
+            params["Shard"] = val_t(to_string(shard_k) + "/" + to_string(shard_n), true);
+            break;
+        case OPT_SUBNETS:
+            subnetfile = optarg;
+            params["Targets"] = val_t(subnetfile, true);
+            break;
+        case OPT_TABLECACHE:
+            tablecache = optarg;
+            break;
+        case OPT_HORIZON:
+            horizon = true;
+            params["Horizon"] = val_t(to_string(horizon), true);
+            break;
+        case OPT_REACHED:
+            reached = true;
+            params["Reached"] = val_t(to_string(reached), true);
+            break;
+        case OPT_STOPSET:
+            stopset = true;
+            params["Stopset"] = val_t(to_string(stopset), true);
+            break;
+        case OPT_RETRIES:
+            n = strtol(optarg, &endptr, 10);
+            if (*endptr != '\0' or n < 0 or n > RETRY_MAX)
+                fatal("Bad retry count %s: expected 0-%d", optarg, RETRY_MAX);
+            retries = n;
+            params["Retries"] = val_t(to_string(retries), true);
+            break;
+        case OPT_ADAPTIVE:
+            adaptive = true;
+            params["Adaptive_Rate"] = val_t(to_string(adaptive), true);
+            break;
+        case OPT_BUDGET:
+            n = strtol(optarg, &endptr, 10);
+            if (*endptr != '\0' or n < 1 or n > UINT32_MAX)
+                fatal("Bad hop budget %s: expected at least 1 pps", optarg);
+            budget = n;
+            params["Hop_Budget"] = val_t(to_string(budget), true);
+            break;
+        case OPT_ASNRATE:
+            n = strtol(optarg, &endptr, 10);
+            if (*endptr != '\0' or n < 1 or n > UINT32_MAX)
+                fatal("Bad AS rate cap %s: expected at least 1 pps", optarg);
+            asn_rate = n;
+            params["ASN_Rate"] = val_t(to_string(asn_rate), true);
+            break;
+        case OPT_ASNMAX:
+            asn_max = strtoull(optarg, &endptr, 10);
+            if (*endptr != '\0' or asn_max < 1)
+                fatal("Bad AS probe cap %s: expected at least 1 probe", optarg);
+            params["ASN_Max"] = val_t(to_string(asn_max), true);
+            break;
+        case OPT_TTLDIST:
+            ttldist = optarg;
+            params["TTL_Dist"] = val_t(ttldist, true);
+            break;
+        case OPT_PIPELINE:
+            pipeline = true;
+            params["Pipeline"] = val_t(to_string(pipeline), true);
+            break;
+        case OPT_COMPILE:
+            compile = optarg;
+            /* compiling draws and filters the scan, but sends nothing */
+            testing = true;
+            break;
+        case OPT_SCHEDULE:
+            schedule = optarg;
+            params["Targets"] = val_t(schedule, true);
+            break;
+        case OPT_BENCH:
+            /* the probe path runs in full, but nothing is sent */
+            bench = true;
+            testing = true;
+            break;
+        case OPT_THREADS:
+            threads = strtol(optarg, &endptr, 10);
+            if (threads < 1 or threads > MAX_THREADS)
+                fatal("Bad thread count %s: expected 1-%d", optarg, MAX_THREADS);
+            params["Threads"] = val_t(to_string(threads), true);
+            break;
         case 'h':
         default:
             usage(argv[0]);
         }
     }
+    /* Subnets given as arguments name the targets, so a resumed scan is
+       checked against them rather than the "entire" default */
+    if (optind < argc) {
+        string targets = subnetfile ? subnetfile : "";
+        for (int i = optind; i < argc; i++)
+            targets += (targets.empty() ? "" : " ") + string(argv[i]);
+        params["Targets"] = val_t(targets, true);
+    }
     if (testing)
         receive = false;
+    /* nothing goes on the wire, so benchmarks run unpaced */
+    if (bench)
+        rate = 0;
     if (not testing) {
         /* set default output file, if not set */
         if (not output) {
@@ -233,7 +379,8 @@ YarrpConfig::parse_opts(int argc, char **argv) {
     params["Max_TTL"] = val_t(to_string(maxttl), true);
     params["TTL_Nbrhd"] = val_t(to_string(ttl_neighborhood), true);
     params["Dst_Port"] = val_t(to_string(dstport), true);
-    params["Output_Fields"] = val_t("target sec usec type code ttl hop rtt ipid psize rsize rttl rtos mpls count", true);
+    params["Output_Fields"] = val_t(string("target sec usec type code ttl hop rtt ipid psize rsize rttl rtos mpls count") +
+                                    (retries ? " retry" : ""), true);
 }
 
 
@@ -263,19 +410,33 @@ YarrpConfig::usage(char *prog) {
     << "                                      ICMP6, UDP6, TCP6_SYN, TCP6_ACK" << endl 
     << "                                      (default: TCP_ACK)" << endl
     << "  -r, --rate              Scan rate in pps (default: 10)" << endl
+    << "      --adaptive-rate     Back the rate off when replies fall off (default: off)" << endl
+    << "      --hop-budget        Max pps to any near hop or destination prefix (default: none)" << endl
     << "  -c, --count             Probes to issue (default: unlimited)" << endl
     << "  -v, --verbose           verbose (default: off)" << endl
     << "  -S, --seed              Seed (default: random)" << endl
     << "  -a, --srcaddr           Source address of probes (default: auto)" << endl
     << "  -p, --port              Transport dst port (default: 80)" << endl
     << "  -T, --test              Don't send probes (default: off)" << endl
+    << "      --bench             Build probes without sending, report ns/probe per stage" << endl
     << "  -E, --instance          Prober instance (default: 0)" << endl
+    << "      --checkpoint        Periodically save scan state to file (default: none)" << endl
+    << "      --resume            Resume scan from checkpoint file (default: off)" << endl
+    << "      --shard             Probe only slice k/n of the scan, 0 <= k < n (default: 0/1)" << endl
 
     << "Target options:" << endl
     << "  -i, --input             Input target file" << endl
+    << "      --subnets           Input subnet file" << endl
     << "  -b, --bgp               BGP table (default: none)" << endl
     << "  -B, --blocklist         Prefix blocklist (default: none)" << endl
+    << "      --table-cache       Directory to cache compiled BGP/blocklist tables (default: none)" << endl
+    << "      --asn-rate          Max pps to any one origin AS (default: none)" << endl
+    << "      --asn-max           Max probes to any one origin AS (default: none)" << endl
     << "  -Q, --entire            Entire IPv4/IPv6 Internet (default: off)" << endl
+    << "      --threads           Sending threads in entire mode (default: 1)" << endl
+    << "      --pipeline          Generate and filter targets on their own threads (default: off)" << endl
+    << "      --compile-schedule  Write the scan's filtered probe order to file, don't probe" << endl
+    << "      --schedule          Probe a compiled schedule file (default: none)" << endl
 
     << "TTL options:" << endl
     << "  -l, --minttl            Minimum TTL (default: 1)" << endl
@@ -284,6 +445,11 @@ YarrpConfig::usage(char *prog) {
     << "  -s, --sequential        Scan sequentially (default: random)" << endl
     << "  -n, --neighborhood      Neighborhood TTL (default: 0)" << endl
     << "  -Z, --poisson           Poisson TTLs (default: uniform)" << endl
+    << "      --ttl-dist          TTLs from poisson:lambda, uniform, or file (default: uniform)" << endl
+    << "      --retries           Re-send unanswered probes up to N times (default: 0)" << endl
+    << "      --horizon           Skip TTLs past where a BGP prefix's traces end (default: off)" << endl
+    << "      --reached           Skip TTLs past where a target answered (default: off)" << endl
+    << "      --stopset           Skip TTLs below interfaces already seen (default: off)" << endl
 
     << "IPv6 options:" << endl
     << "  -I, --interface         Network interface (required for IPv6)" << endl
@@ -5,12 +5,15 @@ class YarrpConfig {
   public:
   YarrpConfig() : rate(10), random_scan(true), ttl_neighborhood(0),
     testing(false), entire(false), output(NULL), 
-    bgpfile(NULL), inlist(NULL), blocklist(NULL),
-    count(0), minttl(1), maxttl(16), seed(0),
+    bgpfile(NULL), inlist(NULL), subnetfile(NULL), blocklist(NULL), tablecache(NULL),
+    count(0), minttl(1), maxttl(16), seed(0), seeded(false),
     dstport(80),
     ipv6(false), int_name(NULL), dstmac(NULL), srcmac(NULL), 
-    coarse(false), fillmode(32), poisson(0),
-    probesrc(NULL), probe(true), receive(true), instance(0), v6_eh(255), out(NULL) {};
+    coarse(false), fillmode(32), poisson(0), ttldist(NULL),
+    probesrc(NULL), probe(true), receive(true), instance(0), v6_eh(255), granularity(50),
+    checkpoint(NULL), resume(false), shard_k(0), shard_n(1), threads(1), horizon(false), reached(false), stopset(false), retries(0), adaptive(false), budget(0), asn_rate(0), asn_max(0), pipeline(false),
+    compile(NULL), schedule(NULL), bench(false),
+    out(NULL) {};
 
   void parse_opts(int argc, char **argv); 
   void usage(char *prog);
@@ -24,11 +27,14 @@ class YarrpConfig {
   char *output;
   char *bgpfile;
   char *inlist;
+  char *subnetfile;  /* input subnets, one per line */
   char *blocklist;
+  char *tablecache;  /* directory of compiled lookup table snapshots */
   uint32_t count;
   uint8_t minttl;
   uint8_t maxttl;
   uint32_t seed;
+  bool seeded;       /* seed given with -S, not the clock */
   uint16_t dstport;
   bool ipv6;
   char *int_name;
@@ -38,12 +44,30 @@ class YarrpConfig {
   bool coarse;
   int fillmode;
   int poisson;
+  char *ttldist;     /* TTL distribution: poisson:lambda, uniform or file */
   char *probesrc;
   bool probe;
   bool receive;
   uint8_t instance;
   uint8_t v6_eh;
   uint8_t granularity;
+  char *checkpoint;  /* periodic scan state file */
+  bool resume;
+  uint32_t shard_k;  /* probe k-th of n slices of the permutation */
+  uint32_t shard_n;
+  uint32_t threads;  /* sending threads (entire mode) */
+  bool horizon;      /* per-prefix TTL horizon (needs BGP table) */
+  bool reached;      /* skip TTLs past where the target answered */
+  bool stopset;      /* skip TTLs below already discovered interfaces */
+  uint8_t retries;   /* passes re-sending unanswered probes */
+  bool adaptive;     /* reply-driven rate control */
+  uint32_t budget;   /* pps any near hop or destination prefix may get */
+  uint32_t asn_rate; /* pps cap per origin AS */
+  uint64_t asn_max;  /* probe cap per origin AS */
+  bool pipeline;     /* generate and filter targets on their own threads */
+  char *compile;     /* write the scan's probe schedule here, don't probe */
+  char *schedule;    /* probe a compiled schedule */
+  bool bench;        /* build probes into a null sink, timing each stage */
   FILE *out;   /* output file stream */
   params_t params;
 